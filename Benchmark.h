@@ -0,0 +1,462 @@
+#ifndef AISDI_BENCHMARK_H
+#define AISDI_BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "LatencyHistogram.h"
+#include "MemoryTracker.h"
+#include "PerfCounters.h"
+
+namespace aisdi
+{
+
+	// Keeps the compiler from discarding a value, and therefore the work that produced it.
+	template <typename Type>
+	inline void doNotOptimize(const Type& value)
+	{
+#if defined(__GNUC__)
+		asm volatile("" : : "m"(value) : "memory");
+#else
+		const volatile char* bytes = reinterpret_cast<const volatile char*>(&value);
+		(void)*bytes;
+#endif
+	}
+
+	// Forces pending writes to memory so that stores into a collection cannot be elided.
+	inline void clobberMemory()
+	{
+#if defined(__GNUC__)
+		asm volatile("" : : : "memory");
+#endif
+	}
+
+	enum class BenchmarkFormat {
+		Text,
+		Json,
+		Csv
+	};
+
+	// Handed to every repetition of a scenario. Untimed setup goes before start(); without start()
+	// and stop() the whole body is timed. Counters report extra numbers such as hit ratios.
+	// Hardware counters, when the runner has them, cover the same part of the body as the clock.
+	// Single operations wrapped in sample() are timed on their own for the latency percentiles.
+	// Allocations are counted over the timed part too, while the peak covers the whole body.
+	class BenchmarkState {
+	public:
+		using clock = std::chrono::steady_clock;
+
+		BenchmarkState()
+			: started(false)
+			, stopped(false)
+			, perf(nullptr)
+			, latencies(nullptr)
+			, track_memory(false)
+			, memory_base()
+			, memory_begin()
+			, memory_end()
+			, memory_after()
+		{}
+
+		void start()
+		{
+			if (track_memory) {
+				memory_begin = MemoryTracker::snapshot();
+			}
+			if (perf != nullptr) {
+				perf->start();
+			}
+			started = true;
+			begin = clock::now();
+		}
+
+		void stop()
+		{
+			end = clock::now();
+			if (perf != nullptr) {
+				perf->stop();
+			}
+			if (track_memory) {
+				memory_end = MemoryTracker::snapshot();
+			}
+			stopped = true;
+		}
+
+		void setCounter(const std::string& name, double value)
+		{
+			for (auto& counter : counters) {
+				if (counter.first == name) {
+					counter.second = value;
+					return;
+				}
+			}
+			counters.emplace_back(name, value);
+		}
+
+		// runs operation and records how long it took; the timestamps cost a few ns, which the total
+		// time of the body includes
+		template <typename Function>
+		void sample(Function operation)
+		{
+			const LatencyClock& clock = LatencyClock::instance();
+			LatencyClock::ticks begin = LatencyClock::now();
+			operation();
+			latencies->record(clock.toNanoseconds(begin, LatencyClock::now()));
+		}
+
+	private:
+		friend class BenchmarkRunner;
+
+		bool started;
+		bool stopped;
+		clock::time_point begin;
+		clock::time_point end;
+		PerfCounters* perf;
+		LatencyHistogram* latencies;
+		bool track_memory;
+		MemorySnapshot memory_base;
+		MemorySnapshot memory_begin;
+		MemorySnapshot memory_end;
+		MemorySnapshot memory_after;
+		std::vector<std::pair<std::string, double>> counters;
+	};
+
+	// Times are nanoseconds per operation; the statistics are taken over the repetitions.
+	struct BenchmarkResult {
+		std::string suite;
+		std::string name;
+		std::size_t operations;
+		std::size_t repetitions;
+		double min_ns;
+		double median_ns;
+		double mean_ns;
+		double p99_ns;
+		double stddev_ns;
+		std::vector<std::pair<std::string, double>> counters;
+	};
+
+	// Runs each scenario for a number of warmup and measured repetitions and reports the spread.
+	// Text and CSV are written as results arrive, JSON once finish() is called.
+	class BenchmarkRunner {
+	public:
+		using size_type = std::size_t;
+
+		explicit BenchmarkRunner(std::ostream& out, BenchmarkFormat format = BenchmarkFormat::Text,
+			size_type warmup = 1, size_type repetitions = 5)
+			: out(out)
+			, format(format)
+			, warmup(warmup)
+			, repetitions(repetitions)
+			, finished(false)
+			, track_memory(false)
+		{
+			if (repetitions == 0) {
+				throw std::invalid_argument("benchmark needs at least one repetition");
+			}
+			if (format == BenchmarkFormat::Csv) {
+				out << "suite,name,operations,repetitions,min_ns,median_ns,mean_ns,p99_ns,stddev_ns,counters\n";
+			}
+		}
+
+		BenchmarkRunner(const BenchmarkRunner&) = delete;
+		BenchmarkRunner& operator=(const BenchmarkRunner&) = delete;
+
+		~BenchmarkRunner()
+		{
+			finish();
+		}
+
+		void beginSuite(const std::string& name)
+		{
+			suite = name;
+			if (format == BenchmarkFormat::Text) {
+				out << "=== Running " << suite << " ===\n";
+			}
+		}
+
+		void endSuite()
+		{
+			if (format == BenchmarkFormat::Text) {
+				out << std::endl;
+			}
+		}
+
+		// body(BenchmarkState&) performs operations operations per call
+		template <typename Function>
+		const BenchmarkResult& run(const std::string& name, size_type operations, Function body)
+		{
+			if (operations == 0) {
+				operations = 1;
+			}
+			LatencyHistogram latencies;
+			for (size_type i = 0; i < warmup; ++i) {
+				BenchmarkState state;
+				measure(state, body, latencies);
+			}
+			latencies.reset();
+
+			std::vector<double> samples;
+			std::vector<std::pair<std::string, std::vector<double>>> events;
+			BenchmarkState state;
+			for (size_type i = 0; i < repetitions; ++i) {
+				state = BenchmarkState();
+				samples.push_back(measure(state, body, latencies) / operations);
+				if (perf != nullptr) {
+					collectEvents(events, operations);
+				}
+			}
+
+			// the median repetition of every hardware event, per operation
+			for (auto& event : events) {
+				std::sort(event.second.begin(), event.second.end());
+				state.counters.emplace_back(event.first, event.second[event.second.size() / 2]);
+			}
+			if (track_memory) {
+				addMemoryCounters(state, operations);
+			}
+			// sampled operations of all repetitions together
+			if (latencies.getCount() != 0) {
+				const std::pair<const char*, double> percentiles[] = {
+					{ "latency_p50_ns", 50 }, { "latency_p90_ns", 90 }, { "latency_p99_ns", 99 }, { "latency_p999_ns", 99.9 },
+				};
+				for (const auto& percentile : percentiles) {
+					state.counters.emplace_back(percentile.first, latencies.percentile(percentile.second));
+				}
+				state.counters.emplace_back("latency_max_ns", latencies.getMax());
+			}
+			results.push_back(summarize(name, operations, samples, std::move(state.counters)));
+			report(results.back());
+			return results.back();
+		}
+
+		void finish()
+		{
+			if (finished) {
+				return;
+			}
+			finished = true;
+			if (format == BenchmarkFormat::Json) {
+				out << "[\n";
+				for (size_type i = 0; i < results.size(); ++i) {
+					writeJson(results[i]);
+					out << (i + 1 < results.size() ? ",\n" : "\n");
+				}
+				out << "]\n";
+			}
+			out.flush();
+		}
+
+		const std::vector<BenchmarkResult>& getResults() const
+		{
+			return results;
+		}
+
+		// Adds cycles, instructions, cache, branch and dTLB misses per operation to the counters of
+		// every following scenario. Returns false, leaving them off, where the system provides none.
+		bool setHardwareCounters(bool enabled)
+		{
+			perf.reset(enabled ? new PerfCounters() : nullptr);
+			if (perf != nullptr && !perf->isAvailable()) {
+				perf.reset();
+				return false;
+			}
+			return true;
+		}
+
+		// Adds allocations and frees per operation, the bytes still live after the body and the peak
+		// bytes live during it, plus the process's peak RSS. The global operator new has to be the
+		// counting one from MemoryTracker.h; returns false where it cannot count.
+		bool setMemoryTracking(bool enabled)
+		{
+			track_memory = enabled && MemoryTracker::isSupported();
+			MemoryTracker::setEnabled(track_memory);
+			return track_memory || !enabled;
+		}
+
+	private:
+		std::ostream& out;
+		BenchmarkFormat format;
+		size_type warmup;
+		size_type repetitions;
+		bool finished;
+		std::string suite;
+		std::vector<BenchmarkResult> results;
+		std::unique_ptr<PerfCounters> perf;
+		bool track_memory;
+
+		template <typename Function>
+		double measure(BenchmarkState& state, Function& body, LatencyHistogram& latencies)
+		{
+			state.perf = perf.get();
+			state.latencies = &latencies;
+			state.track_memory = track_memory;
+			if (track_memory) {
+				MemoryTracker::resetPeak();
+				state.memory_base = MemoryTracker::snapshot();
+				state.memory_begin = state.memory_base;
+			}
+			if (perf != nullptr) {
+				perf->start();
+			}
+			BenchmarkState::clock::time_point begin = BenchmarkState::clock::now();
+			body(state);
+			BenchmarkState::clock::time_point end = BenchmarkState::clock::now();
+			if (perf != nullptr && !state.stopped) {
+				perf->stop();
+			}
+			if (track_memory) {
+				state.memory_after = MemoryTracker::snapshot();
+				if (!state.stopped) {
+					state.memory_end = state.memory_after;
+				}
+			}
+			if (state.started) {
+				begin = state.begin;
+			}
+			if (state.stopped) {
+				end = state.end;
+			}
+			return std::chrono::duration<double, std::nano>(end - begin).count();
+		}
+
+		// from the last repetition; the peak and what the body left behind are relative to its start
+		static void addMemoryCounters(BenchmarkState& state, size_type operations)
+		{
+			const MemorySnapshot& base = state.memory_base;
+			state.counters.emplace_back("allocations",
+				static_cast<double>(state.memory_end.allocations - state.memory_begin.allocations) / operations);
+			state.counters.emplace_back("frees", static_cast<double>(state.memory_end.frees - state.memory_begin.frees) / operations);
+			state.counters.emplace_back("live_bytes", state.memory_after.live_bytes - base.live_bytes);
+			state.counters.emplace_back("peak_bytes", state.memory_after.peak_bytes - base.live_bytes);
+			state.counters.emplace_back("peak_rss_kb", MemoryTracker::peakResidentKilobytes());
+		}
+
+		void collectEvents(std::vector<std::pair<std::string, std::vector<double>>>& events, size_type operations) const
+		{
+			for (const auto& value : perf->read()) {
+				auto event = std::find_if(events.begin(), events.end(),
+					[&value](const std::pair<std::string, std::vector<double>>& item) { return item.first == value.first; });
+				if (event == events.end()) {
+					events.emplace_back(value.first, std::vector<double>());
+					event = events.end() - 1;
+				}
+				event->second.push_back(value.second / operations);
+			}
+		}
+
+		BenchmarkResult summarize(const std::string& name, size_type operations, std::vector<double>& samples,
+			std::vector<std::pair<std::string, double>> counters) const
+		{
+			std::sort(samples.begin(), samples.end());
+			double sum = 0;
+			for (double sample : samples) {
+				sum += sample;
+			}
+			double mean = sum / samples.size();
+			double squares = 0;
+			for (double sample : samples) {
+				squares += (sample - mean) * (sample - mean);
+			}
+
+			BenchmarkResult result;
+			result.suite = suite;
+			result.name = name;
+			result.operations = operations;
+			result.repetitions = samples.size();
+			result.min_ns = samples.front();
+			result.median_ns = samples.size() % 2 != 0 ? samples[samples.size() / 2]
+				: (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2;
+			result.mean_ns = mean;
+			// nearest rank; with few repetitions this is the slowest one
+			result.p99_ns = samples[static_cast<size_type>(std::ceil(0.99 * samples.size())) - 1];
+			result.stddev_ns = samples.size() > 1 ? std::sqrt(squares / (samples.size() - 1)) : 0;
+			result.counters = std::move(counters);
+			return result;
+		}
+
+		void report(const BenchmarkResult& result)
+		{
+			if (format == BenchmarkFormat::Text) {
+				out << result.name << " -> " << formatTime(result.median_ns) << "/op (min " << formatTime(result.min_ns)
+					<< ", mean " << formatTime(result.mean_ns) << ", p99 " << formatTime(result.p99_ns) << ", stddev "
+					<< formatTime(result.stddev_ns) << ", " << result.repetitions << " x " << result.operations << " ops)";
+				for (const auto& counter : result.counters) {
+					out << " " << counter.first << "=" << counter.second;
+				}
+				out << "\n";
+			}
+			else if (format == BenchmarkFormat::Csv) {
+				out << quoteCsv(result.suite) << "," << quoteCsv(result.name) << "," << result.operations << ","
+					<< result.repetitions << "," << result.min_ns << "," << result.median_ns << "," << result.mean_ns << ","
+					<< result.p99_ns << "," << result.stddev_ns << ",";
+				std::ostringstream counters;
+				for (size_type i = 0; i < result.counters.size(); ++i) {
+					counters << (i != 0 ? ";" : "") << result.counters[i].first << "=" << result.counters[i].second;
+				}
+				out << quoteCsv(counters.str()) << "\n";
+			}
+		}
+
+		void writeJson(const BenchmarkResult& result)
+		{
+			out << "  {\"suite\": " << quoteJson(result.suite) << ", \"name\": " << quoteJson(result.name)
+				<< ", \"operations\": " << result.operations << ", \"repetitions\": " << result.repetitions
+				<< ", \"min_ns\": " << result.min_ns << ", \"median_ns\": " << result.median_ns
+				<< ", \"mean_ns\": " << result.mean_ns << ", \"p99_ns\": " << result.p99_ns
+				<< ", \"stddev_ns\": " << result.stddev_ns << ", \"counters\": {";
+			for (size_type i = 0; i < result.counters.size(); ++i) {
+				out << (i != 0 ? ", " : "") << quoteJson(result.counters[i].first) << ": " << result.counters[i].second;
+			}
+			out << "}}";
+		}
+
+		static std::string formatTime(double ns)
+		{
+			const char* units[] = { "ns", "us", "ms", "s" };
+			size_type unit = 0;
+			for (; unit < 3 && ns >= 1000; ++unit) {
+				ns /= 1000;
+			}
+			std::ostringstream text;
+			text << std::setprecision(ns < 10 ? 3 : ns < 100 ? 4 : 5) << ns << units[unit];
+			return text.str();
+		}
+
+		static std::string quoteCsv(const std::string& text)
+		{
+			if (text.find_first_of(",\"\n") == std::string::npos) {
+				return text;
+			}
+			std::string quoted = "\"";
+			for (char c : text) {
+				quoted += c == '"' ? "\"\"" : std::string(1, c);
+			}
+			return quoted + "\"";
+		}
+
+		static std::string quoteJson(const std::string& text)
+		{
+			std::string quoted = "\"";
+			for (char c : text) {
+				if (c == '"' || c == '\\') {
+					quoted += '\\';
+				}
+				quoted += c;
+			}
+			return quoted + "\"";
+		}
+	};
+
+}
+
+#endif /* AISDI_BENCHMARK_H */
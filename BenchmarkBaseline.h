@@ -0,0 +1,239 @@
+#ifndef AISDI_BENCHMARKBASELINE_H
+#define AISDI_BENCHMARKBASELINE_H
+
+#include "Benchmark.h"
+#include <cctype>
+#include <cstddef>
+#include <cstdlib>
+#include <istream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace aisdi
+{
+
+	struct BenchmarkRegression {
+		std::string suite;
+		std::string name;
+		double baseline_ns;
+		double current_ns;
+	};
+
+	// Median times per scenario from an earlier run written with BenchmarkFormat::Json, which is
+	// all the parser understands beyond plain JSON syntax.
+	class BenchmarkBaseline {
+	public:
+		using size_type = std::size_t;
+
+		static BenchmarkBaseline load(std::istream& in)
+		{
+			std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+			BenchmarkBaseline baseline;
+			Parser parser(text);
+			parser.expect('[');
+			if (!parser.consume(']')) {
+				do {
+					baseline.readResult(parser);
+				} while (parser.consume(','));
+				parser.expect(']');
+			}
+			parser.expectEnd();
+			return baseline;
+		}
+
+		size_type getSize() const
+		{
+			return medians.size();
+		}
+
+		// scenarios whose median is more than threshold (0.1 for 10%) slower than in the baseline;
+		// scenarios the baseline does not know are skipped
+		std::vector<BenchmarkRegression> compare(const std::vector<BenchmarkResult>& results, double threshold,
+			size_type* matched = nullptr) const
+		{
+			std::vector<BenchmarkRegression> regressions;
+			size_type count = 0;
+			for (const BenchmarkResult& result : results) {
+				auto baseline = medians.find(std::make_pair(result.suite, result.name));
+				if (baseline == medians.end()) {
+					continue;
+				}
+				++count;
+				if (result.median_ns > baseline->second * (1 + threshold)) {
+					regressions.push_back(BenchmarkRegression{ result.suite, result.name, baseline->second, result.median_ns });
+				}
+			}
+			if (matched != nullptr) {
+				*matched = count;
+			}
+			return regressions;
+		}
+
+	private:
+		std::map<std::pair<std::string, std::string>, double> medians;
+
+		class Parser {
+		public:
+			explicit Parser(const std::string& text)
+				: text(text)
+				, position(0)
+			{}
+
+			bool consume(char c)
+			{
+				skipSpace();
+				if (position < text.size() && text[position] == c) {
+					++position;
+					return true;
+				}
+				return false;
+			}
+
+			void expect(char c)
+			{
+				if (!consume(c)) {
+					fail(std::string("expected '") + c + "'");
+				}
+			}
+
+			void expectEnd()
+			{
+				skipSpace();
+				if (position != text.size()) {
+					fail("trailing characters");
+				}
+			}
+
+			bool atString()
+			{
+				skipSpace();
+				return position < text.size() && text[position] == '"';
+			}
+
+			std::string readString()
+			{
+				expect('"');
+				std::string result;
+				while (position < text.size() && text[position] != '"') {
+					char c = text[position++];
+					if (c == '\\') {
+						if (position == text.size()) {
+							break;
+						}
+						c = text[position++];
+						c = c == 'n' ? '\n' : c == 't' ? '\t' : c == 'r' ? '\r' : c;
+					}
+					result += c;
+				}
+				expect('"');
+				return result;
+			}
+
+			double readNumber()
+			{
+				skipSpace();
+				const char* begin = text.c_str() + position;
+				char* end = nullptr;
+				double value = std::strtod(begin, &end);
+				if (end == begin) {
+					fail("expected a number");
+				}
+				position += end - begin;
+				return value;
+			}
+
+			// steps over any value, nested ones included
+			void skipValue()
+			{
+				if (atString()) {
+					readString();
+				}
+				else if (consume('{')) {
+					if (!consume('}')) {
+						do {
+							readString();
+							expect(':');
+							skipValue();
+						} while (consume(','));
+						expect('}');
+					}
+				}
+				else if (consume('[')) {
+					if (!consume(']')) {
+						do {
+							skipValue();
+						} while (consume(','));
+						expect(']');
+					}
+				}
+				else if (!consumeWord("true") && !consumeWord("false") && !consumeWord("null")) {
+					readNumber();
+				}
+			}
+
+			void fail(const std::string& message) const
+			{
+				throw std::runtime_error("baseline JSON at offset " + std::to_string(position) + ": " + message);
+			}
+
+		private:
+			const std::string& text;
+			size_type position;
+
+			void skipSpace()
+			{
+				while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position]))) {
+					++position;
+				}
+			}
+
+			bool consumeWord(const std::string& word)
+			{
+				skipSpace();
+				if (text.compare(position, word.size(), word) != 0) {
+					return false;
+				}
+				position += word.size();
+				return true;
+			}
+		};
+
+		void readResult(Parser& parser)
+		{
+			std::string suite;
+			std::string name;
+			double median = -1;
+			parser.expect('{');
+			if (!parser.consume('}')) {
+				do {
+					std::string field = parser.readString();
+					parser.expect(':');
+					if (field == "suite") {
+						suite = parser.readString();
+					}
+					else if (field == "name") {
+						name = parser.readString();
+					}
+					else if (field == "median_ns") {
+						median = parser.readNumber();
+					}
+					else {
+						parser.skipValue();
+					}
+				} while (parser.consume(','));
+				parser.expect('}');
+			}
+			if (name.empty() || median < 0) {
+				parser.fail("result without name or median_ns");
+			}
+			medians[std::make_pair(suite, name)] = median;
+		}
+	};
+
+}
+
+#endif /* AISDI_BENCHMARKBASELINE_H */
@@ -0,0 +1,255 @@
+#ifndef AISDI_MAPS_BLOOMFILTER_H
+#define AISDI_MAPS_BLOOMFILTER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace aisdi
+{
+
+	// Set membership with no false negatives and a tunable false positive rate. Every key sets
+	// hash_count bits chosen by double hashing from one mixed hash value.
+	template <typename KeyType, typename Hash = std::hash<KeyType>>
+	class BloomFilter {
+	public:
+		using key_type = KeyType;
+		using size_type = std::size_t;
+
+		// about 10 bits per key give a 1% false positive rate
+		explicit BloomFilter(size_type expected_count, size_type bits_per_key = 10, const Hash& hash = Hash())
+			: words((std::max<size_type>(expected_count * bits_per_key, 64) + 63) / 64, 0)
+			, hash_count(hashCountFor(bits_per_key))
+			, hash(hash)
+		{}
+
+		// restores a filter from getWords() and getHashCount() of one built with the same hash
+		BloomFilter(std::vector<std::uint64_t> words, size_type hash_count, const Hash& hash = Hash())
+			: words(std::move(words))
+			, hash_count(hash_count)
+			, hash(hash)
+		{
+			if (this->words.empty() || hash_count == 0) {
+				throw std::invalid_argument("bloom filter needs at least one word and one hash");
+			}
+		}
+
+		void add(const key_type& key)
+		{
+			std::uint64_t h1, h2;
+			hashes(key, h1, h2);
+			size_type bit_count = getBitCount();
+			for (size_type i = 0; i < hash_count; ++i, h1 += h2) {
+				size_type bit = static_cast<size_type>(h1 % bit_count);
+				words[bit / 64] |= std::uint64_t(1) << (bit % 64);
+			}
+		}
+
+		bool mayContain(const key_type& key) const
+		{
+			std::uint64_t h1, h2;
+			hashes(key, h1, h2);
+			size_type bit_count = getBitCount();
+			for (size_type i = 0; i < hash_count; ++i, h1 += h2) {
+				size_type bit = static_cast<size_type>(h1 % bit_count);
+				if ((words[bit / 64] & (std::uint64_t(1) << (bit % 64))) == 0) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		void clear()
+		{
+			std::fill(words.begin(), words.end(), 0);
+		}
+
+		size_type getBitCount() const
+		{
+			return words.size() * 64;
+		}
+
+		size_type getHashCount() const
+		{
+			return hash_count;
+		}
+
+		const std::vector<std::uint64_t>& getWords() const
+		{
+			return words;
+		}
+
+	private:
+		std::vector<std::uint64_t> words;
+		size_type hash_count;
+		Hash hash;
+
+		// k = bits_per_key * ln 2 minimises the false positive rate
+		static size_type hashCountFor(size_type bits_per_key)
+		{
+			size_type count = bits_per_key * 69 / 100;
+			return count < 1 ? 1 : count > 30 ? 30 : count;
+		}
+
+		// std::hash is the identity for integers on common libraries, so the value is mixed first
+		void hashes(const key_type& key, std::uint64_t& h1, std::uint64_t& h2) const
+		{
+			std::uint64_t mixed = static_cast<std::uint64_t>(hash(key));
+			mixed ^= mixed >> 33;
+			mixed *= 0xFF51AFD7ED558CCDull;
+			mixed ^= mixed >> 33;
+			mixed *= 0xC4CEB9FE1A85EC53ull;
+			mixed ^= mixed >> 33;
+			h1 = mixed;
+			h2 = (mixed >> 32) | (mixed << 32) | 1;
+		}
+	};
+
+	// Bloom filter that keeps all bits of a key in one 64-byte block, so a lookup touches a single
+	// cache line. It needs a little more memory than BloomFilter for the same false positive rate.
+	template <typename KeyType, typename Hash = std::hash<KeyType>>
+	class BlockedBloomFilter {
+	public:
+		using key_type = KeyType;
+		using size_type = std::size_t;
+
+		explicit BlockedBloomFilter(size_type expected_count, double false_positive_rate = 0.01, const Hash& hash = Hash())
+			: hash(hash)
+		{
+			if (!(false_positive_rate > 0 && false_positive_rate < 1)) {
+				throw std::invalid_argument("false positive rate must be between 0 and 1");
+			}
+			// the optimal bits per key, plus a fifth for the uneven load of the blocks
+			double bits_per_key = -std::log(false_positive_rate) / (std::log(2.0) * std::log(2.0)) * 1.2;
+			size_type bit_count = static_cast<size_type>(bits_per_key * std::max<size_type>(expected_count, 1));
+			block_count = std::max<size_type>((bit_count + BLOCK_BITS - 1) / BLOCK_BITS, 1);
+			hash_count = std::min<size_type>(std::max<size_type>(static_cast<size_type>(bits_per_key / 1.2 * 0.69 + 0.5), 1), 16);
+
+			// one spare block lets the first block start on a cache line boundary
+			storage.assign((block_count + 1) * BLOCK_WORDS, 0);
+			offset = (BLOCK_BYTES - reinterpret_cast<std::uintptr_t>(storage.data()) % BLOCK_BYTES) % BLOCK_BYTES / sizeof(std::uint64_t);
+		}
+
+		BlockedBloomFilter(const BlockedBloomFilter& other)
+			: storage(other.storage.size(), 0)
+			, block_count(other.block_count)
+			, hash_count(other.hash_count)
+			, hash(other.hash)
+		{
+			offset = (BLOCK_BYTES - reinterpret_cast<std::uintptr_t>(storage.data()) % BLOCK_BYTES) % BLOCK_BYTES / sizeof(std::uint64_t);
+			std::copy(other.blocks(), other.blocks() + block_count * BLOCK_WORDS, blocks());
+		}
+
+		BlockedBloomFilter& operator=(const BlockedBloomFilter& other)
+		{
+			if (this != &other) {
+				BlockedBloomFilter copy(other);
+				swap(copy);
+			}
+			return *this;
+		}
+
+		BlockedBloomFilter(BlockedBloomFilter&&) = default;
+		BlockedBloomFilter& operator=(BlockedBloomFilter&&) = default;
+
+		void add(const key_type& key)
+		{
+			std::uint64_t h = mix(static_cast<std::uint64_t>(hash(key)));
+			std::uint64_t* block = blocks() + blockOf(h) * BLOCK_WORDS;
+			std::uint64_t bits = mix(h);
+			for (size_type i = 0; i < hash_count; ++i) {
+				if (i != 0 && i % 7 == 0) {
+					bits = mix(bits);
+				}
+				block[(bits & 511) / 64] |= std::uint64_t(1) << (bits & 63);
+				bits >>= 9;
+			}
+		}
+
+		bool mayContain(const key_type& key) const
+		{
+			std::uint64_t h = mix(static_cast<std::uint64_t>(hash(key)));
+			const std::uint64_t* block = blocks() + blockOf(h) * BLOCK_WORDS;
+			std::uint64_t bits = mix(h);
+			bool found = true;
+			for (size_type i = 0; i < hash_count; ++i) {
+				if (i != 0 && i % 7 == 0) {
+					bits = mix(bits);
+				}
+				found &= (block[(bits & 511) / 64] >> (bits & 63)) & 1;
+				bits >>= 9;
+			}
+			return found;
+		}
+
+		void clear()
+		{
+			std::fill(storage.begin(), storage.end(), 0);
+		}
+
+		size_type getBitCount() const
+		{
+			return block_count * BLOCK_BITS;
+		}
+
+		size_type getHashCount() const
+		{
+			return hash_count;
+		}
+
+		void swap(BlockedBloomFilter& other)
+		{
+			std::swap(storage, other.storage);
+			std::swap(offset, other.offset);
+			std::swap(block_count, other.block_count);
+			std::swap(hash_count, other.hash_count);
+			std::swap(hash, other.hash);
+		}
+
+	private:
+		static const size_type BLOCK_BYTES = 64;
+		static const size_type BLOCK_WORDS = BLOCK_BYTES / sizeof(std::uint64_t);
+		static const size_type BLOCK_BITS = BLOCK_BYTES * 8;
+
+		std::vector<std::uint64_t> storage;
+		// words of storage skipped to reach the first cache line boundary
+		size_type offset;
+		size_type block_count;
+		size_type hash_count;
+		Hash hash;
+
+		std::uint64_t* blocks()
+		{
+			return storage.data() + offset;
+		}
+
+		const std::uint64_t* blocks() const
+		{
+			return storage.data() + offset;
+		}
+
+		// maps the high half of the hash onto [0, block_count) without a division
+		size_type blockOf(std::uint64_t h) const
+		{
+			return static_cast<size_type>(((h >> 32) * static_cast<std::uint64_t>(block_count)) >> 32);
+		}
+
+		static std::uint64_t mix(std::uint64_t value)
+		{
+			value ^= value >> 33;
+			value *= 0xFF51AFD7ED558CCDull;
+			value ^= value >> 33;
+			value *= 0xC4CEB9FE1A85EC53ull;
+			value ^= value >> 33;
+			return value;
+		}
+	};
+
+}
+
+#endif /* AISDI_MAPS_BLOOMFILTER_H */
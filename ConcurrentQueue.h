@@ -0,0 +1,292 @@
+#ifndef AISDI_LINEAR_CONCURRENTQUEUE_H
+#define AISDI_LINEAR_CONCURRENTQUEUE_H
+
+#include "EpochReclamation.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace aisdi
+{
+	// Unbounded multi-producer multi-consumer FIFO queue (Michael-Scott). append and the non-blocking
+	// pops are lock-free; dequeued nodes go to the epoch domain because other threads may still be
+	// reading them. Consumers that find the queue empty in popFirst spin briefly and then sleep on a
+	// condition variable, which producers only touch when somebody is actually waiting.
+	template <typename Type>
+	class ConcurrentQueue {
+	public:
+		using size_type = std::size_t;
+		using value_type = Type;
+		using reference = Type&;
+		using const_reference = const Type&;
+
+		ConcurrentQueue()
+			: head(new Node())
+			, tail(head.load(std::memory_order_relaxed))
+			, waiting(0)
+			, closed(false)
+		{}
+
+		ConcurrentQueue(const ConcurrentQueue&) = delete;
+		ConcurrentQueue& operator=(const ConcurrentQueue&) = delete;
+
+		// no other thread may use the queue any more
+		~ConcurrentQueue()
+		{
+			Node* node = head.load(std::memory_order_acquire);
+			Node* next = node->next.load(std::memory_order_relaxed);
+			delete node;
+			for (node = next; node != nullptr; node = next) {
+				next = node->next.load(std::memory_order_relaxed);
+				node->value().~Type();
+				delete node;
+			}
+		}
+
+		// a snapshot; other threads may change it right away
+		bool isEmpty() const
+		{
+			EpochGuard guard;
+			return head.load(std::memory_order_acquire)->next.load(std::memory_order_acquire) == nullptr;
+		}
+
+		void append(const Type& item)
+		{
+			if (closed.load(std::memory_order_relaxed)) {
+				throw std::logic_error("appending to closed queue");
+			}
+			Node* node = new Node(item);
+			{
+				EpochGuard guard;
+				for (;;) {
+					Node* last = tail.load(std::memory_order_acquire);
+					Node* next = last->next.load(std::memory_order_acquire);
+					if (last != tail.load(std::memory_order_acquire)) {
+						continue;
+					}
+					if (next != nullptr) {
+						// another producer linked a node but has not swung tail yet
+						tail.compare_exchange_weak(last, next, std::memory_order_release, std::memory_order_relaxed);
+						continue;
+					}
+					if (last->next.compare_exchange_weak(next, node, std::memory_order_release, std::memory_order_relaxed)) {
+						tail.compare_exchange_strong(last, node, std::memory_order_release, std::memory_order_relaxed);
+						break;
+					}
+				}
+			}
+
+			// pairs with the fence in wait: either the consumer sees the node or we see it waiting
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (waiting.load(std::memory_order_relaxed) != 0) {
+				std::lock_guard<std::mutex> lock(mutex);
+				condition.notify_one();
+			}
+		}
+
+		bool tryPop(Type& item)
+		{
+			EpochGuard guard;
+			Node* node = dequeue();
+			if (node == nullptr) {
+				return false;
+			}
+			item = std::move(node->value());
+			node->value().~Type();
+			return true;
+		}
+
+		// blocks until an element is available; throws once the queue is closed and drained
+		Type popFirst()
+		{
+			// the value has to leave the node while the guard taken by wait is still held
+			typename std::aligned_storage<sizeof(Type), alignof(Type)>::type storage;
+			bool taken = wait([this, &storage]()
+			{
+				Node* node = dequeue();
+				if (node == nullptr) {
+					return false;
+				}
+				new (&storage) Type(std::move(node->value()));
+				node->value().~Type();
+				return true;
+			});
+			if (!taken) {
+				throw std::logic_error("popping first from closed empty queue");
+			}
+			Type& item = *reinterpret_cast<Type*>(&storage);
+			Type result(std::move(item));
+			item.~Type();
+			return result;
+		}
+
+		// blocks until at least one element is available, then moves up to max_count of them to out,
+		// claiming all of them with a single CAS on head; returns 0 once the queue is closed and drained
+		template <typename OutputIt>
+		size_type popMany(OutputIt out, size_type max_count)
+		{
+			size_type count = 0;
+			if (max_count != 0) {
+				wait([this, &out, &count, max_count]() { return (count = tryPopMany(out, max_count)) != 0; });
+			}
+			return count;
+		}
+
+		// like popMany, but returns 0 right away when the queue is empty
+		template <typename OutputIt>
+		size_type tryPopMany(OutputIt out, size_type max_count)
+		{
+			if (max_count == 0) {
+				return 0;
+			}
+			EpochGuard guard;
+			for (;;) {
+				Node* first = head.load(std::memory_order_acquire);
+				Node* last = first;
+				size_type count = 0;
+				for (; count < max_count; ++count) {
+					Node* next = last->next.load(std::memory_order_acquire);
+					if (next == nullptr) {
+						break;
+					}
+					// head must never overtake tail, or tail would point at a retired node
+					Node* expected = last;
+					if (tail.load(std::memory_order_acquire) == last) {
+						tail.compare_exchange_strong(expected, next, std::memory_order_release, std::memory_order_relaxed);
+					}
+					last = next;
+				}
+				if (count == 0) {
+					return 0;
+				}
+				if (head.compare_exchange_strong(first, last, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+					for (Node* node = first; node != last;) {
+						Node* next = node->next.load(std::memory_order_relaxed);
+						*out++ = std::move(next->value());
+						next->value().~Type();
+						EpochDomain::global().retire(node);
+						node = next;
+					}
+					return count;
+				}
+			}
+		}
+
+		// wakes every blocked consumer; later appends throw and popFirst throws once the queue is empty
+		void close()
+		{
+			closed.store(true, std::memory_order_release);
+			std::lock_guard<std::mutex> lock(mutex);
+			condition.notify_all();
+		}
+
+		bool isClosed() const
+		{
+			return closed.load(std::memory_order_acquire);
+		}
+
+	private:
+		static const unsigned SPIN_COUNT = 64;
+		static const size_type CACHE_LINE = 64;
+
+		// the first node is a dummy; every other node holds a value until a consumer takes it
+		class Node {
+		public:
+			std::atomic<Node*> next;
+
+			Node()
+				: next(nullptr)
+			{}
+
+			explicit Node(const Type& item)
+				: next(nullptr)
+			{
+				new (&storage) Type(item);
+			}
+
+			Type& value()
+			{
+				return *reinterpret_cast<Type*>(&storage);
+			}
+
+		private:
+			typename std::aligned_storage<sizeof(Type), alignof(Type)>::type storage;
+		};
+
+		// consumers hammer head and producers hammer tail, so they get separate cache lines
+		std::atomic<Node*> head;
+		char head_padding[CACHE_LINE - sizeof(std::atomic<Node*>)];
+		std::atomic<Node*> tail;
+		char tail_padding[CACHE_LINE - sizeof(std::atomic<Node*>)];
+		std::atomic<size_type> waiting;
+		std::atomic<bool> closed;
+		std::mutex mutex;
+		std::condition_variable condition;
+
+		// retries tryTake, spinning briefly before sleeping until a producer or close() wakes us;
+		// returns false if the queue was closed while empty
+		template <typename Function>
+		bool wait(Function tryTake)
+		{
+			for (unsigned spin = 0; spin < SPIN_COUNT; ++spin) {
+				{
+					EpochGuard guard;
+					if (tryTake()) {
+						return true;
+					}
+				}
+				std::this_thread::yield();
+			}
+
+			std::unique_lock<std::mutex> lock(mutex);
+			waiting.fetch_add(1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			bool taken;
+			for (;;) {
+				{
+					EpochGuard guard;
+					taken = tryTake();
+				}
+				if (taken || closed.load(std::memory_order_acquire)) {
+					break;
+				}
+				condition.wait(lock);
+			}
+			waiting.fetch_sub(1, std::memory_order_relaxed);
+			return taken;
+		}
+
+		// caller holds an EpochGuard; returns the new dummy, whose value now belongs to the caller
+		Node* dequeue()
+		{
+			for (;;) {
+				Node* first = head.load(std::memory_order_acquire);
+				Node* last = tail.load(std::memory_order_acquire);
+				Node* next = first->next.load(std::memory_order_acquire);
+				if (first != head.load(std::memory_order_acquire)) {
+					continue;
+				}
+				if (next == nullptr) {
+					return nullptr;
+				}
+				if (first == last) {
+					tail.compare_exchange_weak(last, next, std::memory_order_release, std::memory_order_relaxed);
+					continue;
+				}
+				if (head.compare_exchange_weak(first, next, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+					EpochDomain::global().retire(first);
+					return next;
+				}
+			}
+		}
+	};
+
+}
+
+#endif // AISDI_LINEAR_CONCURRENTQUEUE_H
@@ -0,0 +1,523 @@
+#ifndef AISDI_MAPS_CONCURRENTSKIPLISTMAP_H
+#define AISDI_MAPS_CONCURRENTSKIPLISTMAP_H
+
+#include "EpochReclamation.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace aisdi
+{
+
+	// Lock-free ordered map (Harris/Fraser skip list). Links carry a deletion mark in their lowest bit;
+	// removed nodes are handed to the epoch domain once they are unlinked from every level.
+	// Iterators pin the current epoch and are weakly consistent; they must stay on the thread that made them.
+	template <typename KeyType, typename ValueType, typename Compare = std::less<KeyType>>
+	class ConcurrentSkipListMap {
+	public:
+		using key_type = KeyType;
+		using mapped_type = ValueType;
+		using value_type = std::pair<const key_type, mapped_type>;
+		using size_type = std::size_t;
+		using reference = std::pair<const key_type&, const mapped_type&>;
+		using const_reference = reference;
+		using key_compare = Compare;
+
+		class ConstIterator;
+		using iterator = ConstIterator;
+		using const_iterator = ConstIterator;
+
+		ConcurrentSkipListMap()
+			: ConcurrentSkipListMap(Compare())
+		{}
+
+		explicit ConcurrentSkipListMap(const Compare& comp)
+			: head(Node::createHead())
+			, top_level(1)
+			, size(0)
+			, comp(comp)
+		{}
+
+		ConcurrentSkipListMap(const ConcurrentSkipListMap&) = delete;
+		ConcurrentSkipListMap& operator=(const ConcurrentSkipListMap&) = delete;
+
+		// no other thread may use the map any more
+		~ConcurrentSkipListMap()
+		{
+			Node* node = pointer(head->next[0].load(std::memory_order_acquire));
+			while (node != nullptr) {
+				Node* next = pointer(node->next[0].load(std::memory_order_relaxed));
+				Node::destroy(node);
+				node = next;
+			}
+			Node::destroyHead(head);
+		}
+
+		bool isEmpty() const
+		{
+			return getSize() == 0;
+		}
+
+		// exact when no updates are in flight
+		size_type getSize() const
+		{
+			return size.load(std::memory_order_relaxed);
+		}
+
+		// inserts or overwrites the value for key; returns true if the key was not present
+		bool upsert(const key_type& key, const mapped_type& value)
+		{
+			return insert(key, value, true);
+		}
+
+		// inserts only if key is absent; returns true if it was inserted
+		bool insert(const key_type& key, const mapped_type& value)
+		{
+			return insert(key, value, false);
+		}
+
+		// returns true if this call removed key
+		bool remove(const key_type& key)
+		{
+			EpochGuard guard;
+			Node* preds[MAX_LEVEL];
+			Node* succs[MAX_LEVEL];
+			if (!findPosition(key, preds, succs)) {
+				return false;
+			}
+
+			Node* node = succs[0];
+			for (int i = node->level - 1; i > 0; --i) {
+				std::uintptr_t next = node->next[i].load(std::memory_order_acquire);
+				while (!isMarked(next)) {
+					node->next[i].compare_exchange_weak(next, next | MARK);
+				}
+			}
+
+			std::uintptr_t next = node->next[0].load(std::memory_order_acquire);
+			for (;;) {
+				if (isMarked(next)) {
+					return false;
+				}
+				if (node->next[0].compare_exchange_weak(next, next | MARK)) {
+					break;
+				}
+			}
+
+			size.fetch_sub(1, std::memory_order_relaxed);
+			finish(node);
+			return true;
+		}
+
+		bool contains(const key_type& key) const
+		{
+			EpochGuard guard;
+			const Node* node = lowerBoundNode(key);
+			return node != nullptr && !comp(key, node->key());
+		}
+
+		mapped_type valueOf(const key_type& key) const
+		{
+			EpochGuard guard;
+			const Node* node = lowerBoundNode(key);
+			if (node == nullptr || comp(key, node->key())) {
+				throw std::out_of_range("cannot access non-existent element");
+			}
+			return *node->value.load(std::memory_order_acquire);
+		}
+
+		const_iterator find(const key_type& key) const
+		{
+			const_iterator result = lowerBound(key);
+			if (result.node != nullptr && comp(key, result.node->key())) {
+				result.node = nullptr;
+			}
+			return result;
+		}
+
+		const_iterator lowerBound(const key_type& key) const
+		{
+			const_iterator result;
+			result.node = lowerBoundNode(key);
+			return result;
+		}
+
+		const_iterator upperBound(const key_type& key) const
+		{
+			const_iterator result;
+			const Node* pred = head;
+			const Node* curr = nullptr;
+			for (int level = top_level.load(std::memory_order_acquire) - 1; level >= 0; --level) {
+				curr = pointer(pred->next[level].load(std::memory_order_acquire));
+				while (curr != nullptr && !comp(key, curr->key())) {
+					pred = curr;
+					curr = pointer(curr->next[level].load(std::memory_order_acquire));
+				}
+			}
+			result.node = skipDeleted(curr);
+			return result;
+		}
+
+		const_iterator cbegin() const
+		{
+			const_iterator result;
+			result.node = skipDeleted(pointer(head->next[0].load(std::memory_order_acquire)));
+			return result;
+		}
+
+		const_iterator cend() const
+		{
+			return const_iterator();
+		}
+
+		const_iterator begin() const
+		{
+			return cbegin();
+		}
+
+		const_iterator end() const
+		{
+			return cend();
+		}
+
+	private:
+		static const int MAX_LEVEL = 16;
+		static const std::uintptr_t MARK = 1;
+
+		using Link = std::atomic<std::uintptr_t>;
+
+		class Node {
+		public:
+			std::atomic<mapped_type*> value;
+			// one for the inserting thread, one for the removing thread; the last one out retires the node
+			std::atomic<int> pending;
+			int level;
+			alignas(key_type) unsigned char storage[sizeof(key_type)];
+			// the tower; level links are allocated past the end of the object
+			Link next[1];
+
+			const key_type& key() const
+			{
+				return *reinterpret_cast<const key_type*>(storage);
+			}
+
+			static Node* create(const key_type& key, const mapped_type& value, int level)
+			{
+				Node* node = allocate(level);
+				try {
+					new (node->storage) key_type(key);
+				}
+				catch (...) {
+					::operator delete(node);
+					throw;
+				}
+				try {
+					node->value.store(new mapped_type(value), std::memory_order_relaxed);
+				}
+				catch (...) {
+					node->key().~key_type();
+					::operator delete(node);
+					throw;
+				}
+				return node;
+			}
+
+			static Node* createHead()
+			{
+				return allocate(MAX_LEVEL);
+			}
+
+			static void destroy(Node* node)
+			{
+				delete node->value.load(std::memory_order_relaxed);
+				node->key().~key_type();
+				::operator delete(node);
+			}
+
+			static void destroyHead(Node* node)
+			{
+				::operator delete(node);
+			}
+
+		private:
+			static Node* allocate(int level)
+			{
+				void* memory = ::operator new(sizeof(Node) + (level - 1) * sizeof(Link));
+				Node* node = static_cast<Node*>(memory);
+				new (&node->value) std::atomic<mapped_type*>(nullptr);
+				new (&node->pending) std::atomic<int>(2);
+				node->level = level;
+				for (int i = 0; i < level; ++i) {
+					new (&node->next[i]) Link(0);
+				}
+				return node;
+			}
+		};
+
+		Node* head;
+		// highest level any tower has reached; searches start here instead of at MAX_LEVEL
+		std::atomic<int> top_level;
+		std::atomic<size_type> size;
+		Compare comp;
+
+		static bool isMarked(std::uintptr_t link)
+		{
+			return (link & MARK) != 0;
+		}
+
+		static Node* pointer(std::uintptr_t link)
+		{
+			return reinterpret_cast<Node*>(link & ~MARK);
+		}
+
+		static std::uintptr_t link(const Node* node)
+		{
+			return reinterpret_cast<std::uintptr_t>(node);
+		}
+
+		// each level is kept with probability 1/4
+		static int randomLevel()
+		{
+			static thread_local std::uint64_t state = reinterpret_cast<std::uintptr_t>(&state) | 1;
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			int level = 1;
+			for (std::uint64_t bits = state; (bits & 3) == 0 && level < MAX_LEVEL; bits >>= 2) {
+				++level;
+			}
+			return level;
+		}
+
+		void raiseTopLevel(int level)
+		{
+			int current = top_level.load(std::memory_order_relaxed);
+			while (current < level && !top_level.compare_exchange_weak(current, level, std::memory_order_release)) {
+			}
+		}
+
+		static const Node* skipDeleted(const Node* node)
+		{
+			while (node != nullptr) {
+				std::uintptr_t next = node->next[0].load(std::memory_order_acquire);
+				if (!isMarked(next)) {
+					break;
+				}
+				node = pointer(next);
+			}
+			return node;
+		}
+
+		const Node* lowerBoundNode(const key_type& key) const
+		{
+			const Node* pred = head;
+			const Node* curr = nullptr;
+			for (int level = top_level.load(std::memory_order_acquire) - 1; level >= 0; --level) {
+				curr = pointer(pred->next[level].load(std::memory_order_acquire));
+				while (curr != nullptr && comp(curr->key(), key)) {
+					pred = curr;
+					curr = pointer(curr->next[level].load(std::memory_order_acquire));
+				}
+			}
+			return skipDeleted(curr);
+		}
+
+		// fills preds/succs around key on every level, unlinking marked nodes on the way;
+		// returns true if an unmarked node with key was found at level 0
+		bool findPosition(const key_type& key, Node** preds, Node** succs)
+		{
+			for (;;) {
+				bool restart = false;
+				Node* pred = head;
+				Node* curr = nullptr;
+				int top = top_level.load(std::memory_order_acquire);
+				for (int level = MAX_LEVEL - 1; level >= top; --level) {
+					preds[level] = head;
+					succs[level] = nullptr;
+				}
+				for (int level = top - 1; level >= 0 && !restart; --level) {
+					curr = pointer(pred->next[level].load(std::memory_order_acquire));
+					while (curr != nullptr) {
+						std::uintptr_t next = curr->next[level].load(std::memory_order_acquire);
+						if (isMarked(next)) {
+							std::uintptr_t expected = link(curr);
+							if (!pred->next[level].compare_exchange_strong(expected, next & ~MARK)) {
+								restart = true;
+								break;
+							}
+							curr = pointer(next);
+							continue;
+						}
+						if (!comp(curr->key(), key)) {
+							break;
+						}
+						pred = curr;
+						curr = pointer(next);
+					}
+					preds[level] = pred;
+					succs[level] = curr;
+				}
+				if (!restart) {
+					return curr != nullptr && !comp(key, curr->key());
+				}
+			}
+		}
+
+		bool insert(const key_type& key, const mapped_type& value, bool assign)
+		{
+			EpochGuard guard;
+			Node* preds[MAX_LEVEL];
+			Node* succs[MAX_LEVEL];
+			Node* node = nullptr;
+			int level = randomLevel();
+			raiseTopLevel(level);
+
+			for (;;) {
+				if (findPosition(key, preds, succs)) {
+					if (assign) {
+						mapped_type* old = succs[0]->value.exchange(new mapped_type(value), std::memory_order_acq_rel);
+						EpochDomain::global().retire(old);
+					}
+					if (node != nullptr) {
+						Node::destroy(node);
+					}
+					return false;
+				}
+
+				if (node == nullptr) {
+					node = Node::create(key, value, level);
+				}
+				for (int i = 0; i < level; ++i) {
+					node->next[i].store(link(succs[i]), std::memory_order_relaxed);
+				}
+				std::uintptr_t expected = link(succs[0]);
+				if (preds[0]->next[0].compare_exchange_strong(expected, link(node), std::memory_order_release)) {
+					break;
+				}
+			}
+			size.fetch_add(1, std::memory_order_relaxed);
+
+			for (int i = 1; i < level; ++i) {
+				if (!linkLevel(node, i, preds, succs)) {
+					break;
+				}
+			}
+			finish(node);
+			return true;
+		}
+
+		// returns false once node has been marked for removal
+		bool linkLevel(Node* node, int i, Node** preds, Node** succs)
+		{
+			for (;;) {
+				std::uintptr_t current = node->next[i].load(std::memory_order_acquire);
+				if (isMarked(current)) {
+					return false;
+				}
+				if (current != link(succs[i]) && !node->next[i].compare_exchange_strong(current, link(succs[i]))) {
+					return false;
+				}
+				std::uintptr_t expected = link(succs[i]);
+				if (preds[i]->next[i].compare_exchange_strong(expected, link(node), std::memory_order_release)) {
+					return true;
+				}
+				findPosition(node->key(), preds, succs);
+				if (succs[0] != node) {
+					return false;
+				}
+			}
+		}
+
+		// the last of the inserting and removing threads unlinks the node from every level and retires it
+		void finish(Node* node)
+		{
+			if (node->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				Node* preds[MAX_LEVEL];
+				Node* succs[MAX_LEVEL];
+				findPosition(node->key(), preds, succs);
+				EpochDomain::global().retire(node, [](void* pointer) { Node::destroy(static_cast<Node*>(pointer)); });
+			}
+		}
+	};
+
+	template <typename KeyType, typename ValueType, typename Compare>
+	class ConcurrentSkipListMap<KeyType, ValueType, Compare>::ConstIterator {
+	public:
+		using reference = typename ConcurrentSkipListMap::const_reference;
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = typename ConcurrentSkipListMap::value_type;
+
+		class pointer {
+		public:
+			explicit pointer(reference ref)
+				: ref(ref)
+			{}
+
+			const reference* operator->() const
+			{
+				return &ref;
+			}
+
+		private:
+			reference ref;
+		};
+
+		friend class ConcurrentSkipListMap;
+
+		ConstIterator()
+			: node(nullptr)
+		{}
+
+		ConstIterator& operator++()
+		{
+			if (node == nullptr) {
+				throw std::out_of_range("cannot increment end() iterator");
+			}
+			node = skipDeleted(ConcurrentSkipListMap::pointer(node->next[0].load(std::memory_order_acquire)));
+			return *this;
+		}
+
+		ConstIterator operator++(int)
+		{
+			ConstIterator copy = *this;
+			++(*this);
+			return copy;
+		}
+
+		reference operator*() const
+		{
+			if (node == nullptr) {
+				throw std::out_of_range("cannot dereference end() iterator");
+			}
+			return reference(node->key(), *node->value.load(std::memory_order_acquire));
+		}
+
+		pointer operator->() const
+		{
+			return pointer(this->operator*());
+		}
+
+		bool operator==(const ConstIterator& other) const
+		{
+			return node == other.node;
+		}
+
+		bool operator!=(const ConstIterator& other) const
+		{
+			return !(*this == other);
+		}
+
+	private:
+		// keeps every node reachable from here alive
+		EpochGuard guard;
+		const Node* node;
+	};
+
+}
+
+#endif /* AISDI_MAPS_CONCURRENTSKIPLISTMAP_H */
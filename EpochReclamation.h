@@ -0,0 +1,253 @@
+#ifndef AISDI_MAPS_EPOCHRECLAMATION_H
+#define AISDI_MAPS_EPOCHRECLAMATION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace aisdi
+{
+
+	// Epoch-based reclamation for the lock-free containers. A thread holds an EpochGuard while it may
+	// dereference shared nodes; a retired node is freed only after every guard that could have seen it
+	// has been released. The domain is process-wide, so nodes may be retired from any container.
+	class EpochDomain {
+	public:
+		using size_type = std::size_t;
+
+		static EpochDomain& global()
+		{
+			static EpochDomain domain;
+			return domain;
+		}
+
+		EpochDomain(const EpochDomain&) = delete;
+		EpochDomain& operator=(const EpochDomain&) = delete;
+
+		~EpochDomain()
+		{
+			for (Record* record = records.load(std::memory_order_acquire); record != nullptr; ) {
+				Record* next = record->next;
+				freeAll(record->retired);
+				delete record;
+				record = next;
+			}
+			freeAll(orphans);
+		}
+
+		void enter()
+		{
+			Record* record = localRecord();
+			if (record->nesting++ == 0) {
+				record->state.store((epoch.load(std::memory_order_relaxed) << 1) | 1, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+			}
+		}
+
+		void exit()
+		{
+			Record* record = localRecord();
+			if (--record->nesting == 0) {
+				record->state.store(0, std::memory_order_release);
+			}
+		}
+
+		template <typename Type>
+		void retire(Type* object)
+		{
+			retire(object, [](void* pointer) { delete static_cast<Type*>(pointer); });
+		}
+
+		// object must already be unreachable for threads that enter a guard from now on
+		void retire(void* object, void (*deleter)(void*))
+		{
+			if (object == nullptr) {
+				return;
+			}
+			Record* record = localRecord();
+			record->retired.push_back(Retired{ object, deleter, epoch.load(std::memory_order_acquire) });
+			if (record->retired.size() >= record->collect_at) {
+				collect(record->retired);
+				// while a stalled guard holds the epoch back nothing can be freed, so wait for the list
+				// to double instead of rescanning it on every retire
+				size_type kept = record->retired.size();
+				record->collect_at = 2 * kept > COLLECT_THRESHOLD ? 2 * kept : COLLECT_THRESHOLD;
+			}
+		}
+
+	private:
+		static const size_type COLLECT_THRESHOLD = 128;
+
+		struct Retired {
+			void* object;
+			void (*deleter)(void*);
+			std::uint64_t epoch;
+		};
+
+		struct Record {
+			Record()
+				: state(0)
+				, inUse(true)
+				, next(nullptr)
+				, nesting(0)
+				, collect_at(COLLECT_THRESHOLD)
+			{}
+
+			// (epoch << 1) | 1 while the owning thread is inside a guard, 0 otherwise
+			std::atomic<std::uint64_t> state;
+			std::atomic<bool> inUse;
+			Record* next;
+			size_type nesting;
+			size_type collect_at;
+			std::vector<Retired> retired;
+		};
+
+		// detaches the thread's record when the thread exits
+		struct ThreadHandle {
+			EpochDomain* domain;
+			Record* record;
+
+			~ThreadHandle()
+			{
+				if (record != nullptr) {
+					domain->release(record);
+				}
+			}
+		};
+
+		std::atomic<std::uint64_t> epoch;
+		std::atomic<Record*> records;
+		std::mutex orphans_mutex;
+		std::vector<Retired> orphans;
+
+		EpochDomain()
+			: epoch(0)
+			, records(nullptr)
+		{}
+
+		Record* localRecord()
+		{
+			static thread_local ThreadHandle handle{ this, nullptr };
+			if (handle.record == nullptr) {
+				handle.record = acquire();
+			}
+			return handle.record;
+		}
+
+		Record* acquire()
+		{
+			for (Record* record = records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+				bool expected = false;
+				if (!record->inUse.load(std::memory_order_relaxed)
+					&& record->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+					return record;
+				}
+			}
+
+			Record* record = new Record();
+			Record* head = records.load(std::memory_order_relaxed);
+			do {
+				record->next = head;
+			} while (!records.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+			return record;
+		}
+
+		void release(Record* record)
+		{
+			{
+				std::lock_guard<std::mutex> lock(orphans_mutex);
+				orphans.insert(orphans.end(), record->retired.begin(), record->retired.end());
+			}
+			record->retired.clear();
+			record->nesting = 0;
+			record->collect_at = COLLECT_THRESHOLD;
+			record->state.store(0, std::memory_order_release);
+			record->inUse.store(false, std::memory_order_release);
+		}
+
+		bool tryAdvance()
+		{
+			std::uint64_t current = epoch.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			for (Record* record = records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+				std::uint64_t state = record->state.load(std::memory_order_acquire);
+				if ((state & 1) != 0 && (state >> 1) != current) {
+					return false;
+				}
+			}
+			return epoch.compare_exchange_strong(current, current + 1);
+		}
+
+		// frees everything retired at least two epochs ago
+		void collect(std::vector<Retired>& retired)
+		{
+			tryAdvance();
+			std::uint64_t current = epoch.load(std::memory_order_acquire);
+
+			std::vector<Retired> expired;
+			size_type kept = 0;
+			for (const Retired& item : retired) {
+				if (item.epoch + 2 <= current) {
+					expired.push_back(item);
+				}
+				else {
+					retired[kept++] = item;
+				}
+			}
+			retired.resize(kept);
+
+			std::unique_lock<std::mutex> lock(orphans_mutex, std::try_to_lock);
+			if (lock.owns_lock()) {
+				kept = 0;
+				for (const Retired& item : orphans) {
+					if (item.epoch + 2 <= current) {
+						expired.push_back(item);
+					}
+					else {
+						orphans[kept++] = item;
+					}
+				}
+				orphans.resize(kept);
+				lock.unlock();
+			}
+
+			freeAll(expired);
+		}
+
+		static void freeAll(std::vector<Retired>& retired)
+		{
+			for (const Retired& item : retired) {
+				item.deleter(item.object);
+			}
+			retired.clear();
+		}
+	};
+
+	class EpochGuard {
+	public:
+		EpochGuard()
+		{
+			EpochDomain::global().enter();
+		}
+
+		EpochGuard(const EpochGuard&)
+		{
+			EpochDomain::global().enter();
+		}
+
+		EpochGuard& operator=(const EpochGuard&)
+		{
+			return *this;
+		}
+
+		~EpochGuard()
+		{
+			EpochDomain::global().exit();
+		}
+	};
+
+}
+
+#endif /* AISDI_MAPS_EPOCHRECLAMATION_H */
@@ -0,0 +1,196 @@
+#ifndef AISDI_MAPS_FILTEREDMAP_H
+#define AISDI_MAPS_FILTEREDMAP_H
+
+#include "BloomFilter.h"
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <stdexcept>
+
+namespace aisdi
+{
+
+	// Puts a blocked Bloom filter in front of any of the maps, so that looking up a missing key
+	// usually costs one cache line instead of a bucket chain or a root-to-leaf path. Removed keys
+	// stay set in the filter until it is rebuilt, which happens once they outnumber the live ones.
+	template <typename Map, typename Hash = std::hash<typename Map::key_type>>
+	class FilteredMap {
+	public:
+		using map_type = Map;
+		using key_type = typename Map::key_type;
+		using mapped_type = typename Map::mapped_type;
+		using value_type = typename Map::value_type;
+		using size_type = typename Map::size_type;
+		using iterator = typename Map::iterator;
+		using const_iterator = typename Map::const_iterator;
+
+		explicit FilteredMap(double false_positive_rate = 0.01)
+			: false_positive_rate(false_positive_rate)
+			, capacity(MIN_CAPACITY)
+			, filter(MIN_CAPACITY, false_positive_rate)
+			, stale(0)
+		{}
+
+		FilteredMap(std::initializer_list<value_type> list)
+			: FilteredMap()
+		{
+			for (auto&& it : list) {
+				(*this)[it.first] = it.second;
+			}
+		}
+
+		bool isEmpty() const
+		{
+			return map.isEmpty();
+		}
+
+		mapped_type& operator[](const key_type& key)
+		{
+			mapped_type& value = map[key];
+			filter.add(key);
+			if (map.getSize() > capacity) {
+				rebuildFilter();
+			}
+			return value;
+		}
+
+		const mapped_type& valueOf(const key_type& key) const
+		{
+			if (!filter.mayContain(key)) {
+				throw std::out_of_range("cannot access non-existent element");
+			}
+			return map.valueOf(key);
+		}
+
+		mapped_type& valueOf(const key_type& key)
+		{
+			if (!filter.mayContain(key)) {
+				throw std::out_of_range("cannot access non-existent element");
+			}
+			return map.valueOf(key);
+		}
+
+		const_iterator find(const key_type& key) const
+		{
+			if (!filter.mayContain(key)) {
+				return map.end();
+			}
+			return map.find(key);
+		}
+
+		iterator find(const key_type& key)
+		{
+			if (!filter.mayContain(key)) {
+				return map.end();
+			}
+			return map.find(key);
+		}
+
+		bool contains(const key_type& key) const
+		{
+			return find(key) != map.end();
+		}
+
+		void remove(const key_type& key)
+		{
+			map.remove(key);
+			afterRemove();
+		}
+
+		void remove(const const_iterator& it)
+		{
+			map.remove(it);
+			afterRemove();
+		}
+
+		size_type getSize() const
+		{
+			return map.getSize();
+		}
+
+		// sizes a fresh filter for the current contents, dropping the keys removed since the last one
+		void rebuildFilter()
+		{
+			capacity = MIN_CAPACITY;
+			while (capacity < map.getSize()) {
+				capacity *= 2;
+			}
+			BlockedBloomFilter<key_type, Hash> rebuilt(capacity, false_positive_rate);
+			for (auto it = map.begin(); it != map.end(); ++it) {
+				rebuilt.add(it->first);
+			}
+			filter.swap(rebuilt);
+			stale = 0;
+		}
+
+		double getFalsePositiveRate() const
+		{
+			return false_positive_rate;
+		}
+
+		const map_type& getMap() const
+		{
+			return map;
+		}
+
+		bool operator==(const FilteredMap& other) const
+		{
+			return map == other.map;
+		}
+
+		bool operator!=(const FilteredMap& other) const
+		{
+			return !(*this == other);
+		}
+
+		iterator begin()
+		{
+			return map.begin();
+		}
+
+		iterator end()
+		{
+			return map.end();
+		}
+
+		const_iterator cbegin() const
+		{
+			return map.cbegin();
+		}
+
+		const_iterator cend() const
+		{
+			return map.cend();
+		}
+
+		const_iterator begin() const
+		{
+			return map.begin();
+		}
+
+		const_iterator end() const
+		{
+			return map.end();
+		}
+
+	private:
+		static const size_type MIN_CAPACITY = 64;
+
+		map_type map;
+		double false_positive_rate;
+		// keys the filter was sized for; it is rebuilt twice as large once the map outgrows it
+		size_type capacity;
+		BlockedBloomFilter<key_type, Hash> filter;
+		size_type stale;
+
+		void afterRemove()
+		{
+			if (++stale > map.getSize() && stale >= MIN_CAPACITY) {
+				rebuildFilter();
+			}
+		}
+	};
+
+}
+
+#endif /* AISDI_MAPS_FILTEREDMAP_H */
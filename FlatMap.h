@@ -0,0 +1,515 @@
+#ifndef AISDI_MAPS_FLATMAP_H
+#define AISDI_MAPS_FLATMAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace aisdi
+{
+
+	// Ordered map stored as two parallel sorted vectors, one of keys and one of values. Lookups are
+	// a branchless binary search over contiguous keys and iteration is a linear scan; inserting or
+	// removing a single element shifts the tail, so it suits maps that are built once and read often.
+	template <typename KeyType, typename ValueType, typename Compare = std::less<KeyType>>
+	class FlatMap {
+	public:
+		using key_type = KeyType;
+		using mapped_type = ValueType;
+		using value_type = std::pair<const key_type, mapped_type>;
+		using size_type = std::size_t;
+		// keys and values live apart, so elements are handed out as pairs of references
+		using reference = std::pair<const key_type&, mapped_type&>;
+		using const_reference = std::pair<const key_type&, const mapped_type&>;
+		using key_compare = Compare;
+
+		class ConstIterator;
+		class Iterator;
+		using iterator = Iterator;
+		using const_iterator = ConstIterator;
+
+		FlatMap()
+			: FlatMap(Compare())
+		{}
+
+		explicit FlatMap(const Compare& comp)
+			: comp(comp)
+		{}
+
+		FlatMap(std::initializer_list<value_type> list)
+			: FlatMap()
+		{
+			insert(list.begin(), list.end());
+		}
+
+		bool isEmpty() const
+		{
+			return keys.empty();
+		}
+
+		void clear()
+		{
+			keys.clear();
+			values.clear();
+		}
+
+		void reserve(size_type count)
+		{
+			keys.reserve(count);
+			values.reserve(count);
+		}
+
+		mapped_type& operator[](const key_type& key)
+		{
+			size_type index = lowerBoundIndex(key);
+			if (index == keys.size() || comp(key, keys[index])) {
+				keys.insert(keys.begin() + index, key);
+				try {
+					values.insert(values.begin() + index, mapped_type());
+				}
+				catch (...) {
+					keys.erase(keys.begin() + index);
+					throw;
+				}
+			}
+			return values[index];
+		}
+
+		const mapped_type& valueOf(const key_type& key) const
+		{
+			size_type index = findIndex(key);
+			if (index == keys.size()) {
+				throw std::out_of_range("cannot access non-existent element");
+			}
+			return values[index];
+		}
+
+		mapped_type& valueOf(const key_type& key)
+		{
+			size_type index = findIndex(key);
+			if (index == keys.size()) {
+				throw std::out_of_range("cannot access non-existent element");
+			}
+			return values[index];
+		}
+
+		const_iterator find(const key_type& key) const
+		{
+			return const_iterator(*this, findIndex(key));
+		}
+
+		iterator find(const key_type& key)
+		{
+			return iterator(*this, findIndex(key));
+		}
+
+		const_iterator lowerBound(const key_type& key) const
+		{
+			return const_iterator(*this, lowerBoundIndex(key));
+		}
+
+		iterator lowerBound(const key_type& key)
+		{
+			return iterator(*this, lowerBoundIndex(key));
+		}
+
+		const_iterator upperBound(const key_type& key) const
+		{
+			return const_iterator(*this, upperBoundIndex(key));
+		}
+
+		iterator upperBound(const key_type& key)
+		{
+			return iterator(*this, upperBoundIndex(key));
+		}
+
+		key_compare keyComp() const
+		{
+			return comp;
+		}
+
+		void remove(const key_type& key)
+		{
+			remove(find(key));
+		}
+
+		void remove(const const_iterator& it)
+		{
+			if (isEmpty()) {
+				throw std::out_of_range("cannot remove from empty map");
+			}
+
+			if (it == end()) {
+				throw std::out_of_range("cannot remove element with non-existent key");
+			}
+
+			keys.erase(keys.begin() + it.index);
+			values.erase(values.begin() + it.index);
+		}
+
+		size_type getSize() const
+		{
+			return keys.size();
+		}
+
+		// bytes held by the key and value arrays, not counting memory the elements own themselves
+		size_type getMemoryUsage() const
+		{
+			return keys.capacity() * sizeof(key_type) + values.capacity() * sizeof(mapped_type);
+		}
+
+		// builds the map in O(n) from a range strictly ascending by key
+		template <typename InputIt>
+		static FlatMap fromSorted(InputIt from, InputIt to, const Compare& comp = Compare())
+		{
+			FlatMap result(comp);
+			for (; from != to; ++from) {
+				if (!result.keys.empty() && !comp(result.keys.back(), from->first)) {
+					throw std::invalid_argument("range is not strictly ascending by key");
+				}
+				result.keys.push_back(from->first);
+				result.values.push_back(from->second);
+			}
+			return result;
+		}
+
+		// adds the elements of an unsorted range with a single merge pass; keys already in the map,
+		// and repeated keys in the range, keep the value seen first
+		template <typename InputIt>
+		void insert(InputIt from, InputIt to)
+		{
+			std::vector<std::pair<key_type, mapped_type>> batch;
+			for (; from != to; ++from) {
+				batch.emplace_back(from->first, from->second);
+			}
+			std::stable_sort(batch.begin(), batch.end(),
+				[this](const std::pair<key_type, mapped_type>& a, const std::pair<key_type, mapped_type>& b) {
+					return comp(a.first, b.first);
+				});
+
+			std::vector<key_type> merged_keys;
+			std::vector<mapped_type> merged_values;
+			merged_keys.reserve(keys.size() + batch.size());
+			merged_values.reserve(keys.size() + batch.size());
+			size_type a = 0;
+			auto b = batch.begin();
+			while (a < keys.size() || b != batch.end()) {
+				if (b == batch.end() || (a < keys.size() && !comp(b->first, keys[a]))) {
+					// skip batch elements equal to the one about to be kept
+					for (; b != batch.end() && !comp(keys[a], b->first); ++b) {}
+					merged_keys.push_back(std::move(keys[a]));
+					merged_values.push_back(std::move(values[a]));
+					++a;
+				}
+				else {
+					auto equal = b;
+					for (++b; b != batch.end() && !comp(equal->first, b->first); ++b) {}
+					merged_keys.push_back(std::move(equal->first));
+					merged_values.push_back(std::move(equal->second));
+				}
+			}
+			keys.swap(merged_keys);
+			values.swap(merged_values);
+		}
+
+		// moves elements with keys absent from this map out of other, leaving duplicates in other
+		void merge(FlatMap& other)
+		{
+			if (this == &other) {
+				return;
+			}
+
+			FlatMap merged(comp);
+			FlatMap left_over(other.comp);
+			merged.reserve(keys.size() + other.keys.size());
+			size_type a = 0;
+			size_type b = 0;
+			while (a < keys.size() || b < other.keys.size()) {
+				if (b == other.keys.size() || (a < keys.size() && comp(keys[a], other.keys[b]))) {
+					merged.append(std::move(keys[a]), std::move(values[a]));
+					++a;
+				}
+				else if (a == keys.size() || comp(other.keys[b], keys[a])) {
+					merged.append(std::move(other.keys[b]), std::move(other.values[b]));
+					++b;
+				}
+				else {
+					merged.append(std::move(keys[a]), std::move(values[a]));
+					left_over.append(std::move(other.keys[b]), std::move(other.values[b]));
+					++a;
+					++b;
+				}
+			}
+			keys.swap(merged.keys);
+			values.swap(merged.values);
+			other.keys.swap(left_over.keys);
+			other.values.swap(left_over.values);
+		}
+
+		void merge(FlatMap&& other)
+		{
+			merge(other);
+		}
+
+		bool operator==(const FlatMap& other) const
+		{
+			return keys == other.keys && values == other.values;
+		}
+
+		bool operator!=(const FlatMap& other) const
+		{
+			return !(*this == other);
+		}
+
+		iterator begin()
+		{
+			return iterator(*this, 0);
+		}
+
+		iterator end()
+		{
+			return iterator(*this, keys.size());
+		}
+
+		const_iterator cbegin() const
+		{
+			return const_iterator(*this, 0);
+		}
+
+		const_iterator cend() const
+		{
+			return const_iterator(*this, keys.size());
+		}
+
+		const_iterator begin() const
+		{
+			return cbegin();
+		}
+
+		const_iterator end() const
+		{
+			return cend();
+		}
+
+	private:
+		std::vector<key_type> keys;
+		std::vector<mapped_type> values;
+		Compare comp;
+
+		void append(key_type&& key, mapped_type&& value)
+		{
+			keys.push_back(std::move(key));
+			values.push_back(std::move(value));
+		}
+
+		// the loop narrows the range by halves with a conditional move instead of a branch,
+		// so its trip count depends only on the size and the search does not mispredict
+		size_type lowerBoundIndex(const key_type& key) const
+		{
+			if (keys.empty()) {
+				return 0;
+			}
+			const key_type* base = keys.data();
+			for (size_type length = keys.size(); length > 1; ) {
+				size_type half = length / 2;
+				base = comp(base[half], key) ? base + half : base;
+				length -= half;
+			}
+			return (base - keys.data()) + comp(*base, key);
+		}
+
+		size_type upperBoundIndex(const key_type& key) const
+		{
+			if (keys.empty()) {
+				return 0;
+			}
+			const key_type* base = keys.data();
+			for (size_type length = keys.size(); length > 1; ) {
+				size_type half = length / 2;
+				base = !comp(key, base[half]) ? base + half : base;
+				length -= half;
+			}
+			return (base - keys.data()) + !comp(key, *base);
+		}
+
+		size_type findIndex(const key_type& key) const
+		{
+			size_type index = lowerBoundIndex(key);
+			if (index != keys.size() && comp(key, keys[index])) {
+				return keys.size();
+			}
+			return index;
+		}
+	};
+
+	template <typename KeyType, typename ValueType, typename Compare>
+	class FlatMap<KeyType, ValueType, Compare>::ConstIterator {
+	public:
+		using reference = typename FlatMap::const_reference;
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = typename FlatMap::value_type;
+
+		class pointer {
+		public:
+			explicit pointer(reference ref)
+				: ref(ref)
+			{}
+
+			const reference* operator->() const
+			{
+				return &ref;
+			}
+
+		private:
+			reference ref;
+		};
+
+		friend class FlatMap;
+
+		explicit ConstIterator(const FlatMap& parent, size_type index)
+			: parent(&parent)
+			, index(index)
+		{}
+
+		ConstIterator& operator++()
+		{
+			if (index == parent->keys.size()) {
+				throw std::out_of_range("cannot increment end() iterator");
+			}
+
+			++index;
+			return *this;
+		}
+
+		ConstIterator operator++(int)
+		{
+			ConstIterator copy = *this;
+			++(*this);
+			return copy;
+		}
+
+		ConstIterator& operator--()
+		{
+			if (index == 0) {
+				throw std::out_of_range("cannot decrement begin() iterator");
+			}
+
+			--index;
+			return *this;
+		}
+
+		ConstIterator operator--(int)
+		{
+			ConstIterator copy = *this;
+			--(*this);
+			return copy;
+		}
+
+		reference operator*() const
+		{
+			if (index == parent->keys.size()) {
+				throw std::out_of_range("cannot dereference end() iterator");
+			}
+
+			return reference(parent->keys[index], parent->values[index]);
+		}
+
+		pointer operator->() const
+		{
+			return pointer(this->operator*());
+		}
+
+		bool operator==(const ConstIterator& other) const
+		{
+			return index == other.index;
+		}
+
+		bool operator!=(const ConstIterator& other) const
+		{
+			return !(*this == other);
+		}
+
+	protected:
+		const FlatMap* parent;
+		size_type index;
+	};
+
+	template <typename KeyType, typename ValueType, typename Compare>
+	class FlatMap<KeyType, ValueType, Compare>::Iterator : public FlatMap<KeyType, ValueType, Compare>::ConstIterator {
+	public:
+		using reference = typename FlatMap::reference;
+
+		class pointer {
+		public:
+			explicit pointer(reference ref)
+				: ref(ref)
+			{}
+
+			const reference* operator->() const
+			{
+				return &ref;
+			}
+
+		private:
+			reference ref;
+		};
+
+		explicit Iterator(const FlatMap& parent, size_type index)
+			: ConstIterator(parent, index)
+		{}
+
+		Iterator(const ConstIterator& other)
+			: ConstIterator(other)
+		{}
+
+		Iterator& operator++()
+		{
+			ConstIterator::operator++();
+			return *this;
+		}
+
+		Iterator operator++(int)
+		{
+			auto result = *this;
+			ConstIterator::operator++();
+			return result;
+		}
+
+		Iterator& operator--()
+		{
+			ConstIterator::operator--();
+			return *this;
+		}
+
+		Iterator operator--(int)
+		{
+			auto result = *this;
+			ConstIterator::operator--();
+			return result;
+		}
+
+		pointer operator->() const
+		{
+			return pointer(this->operator*());
+		}
+
+		reference operator*() const
+		{
+			if (this->index == this->parent->keys.size()) {
+				throw std::out_of_range("cannot dereference end() iterator");
+			}
+
+			// iterators are only created from a non-const map
+			FlatMap& map = const_cast<FlatMap&>(*this->parent);
+			return reference(map.keys[this->index], map.values[this->index]);
+		}
+	};
+
+}
+
+#endif /* AISDI_MAPS_FLATMAP_H */
@@ -0,0 +1,369 @@
+#ifndef AISDI_MAPS_FROZENTREEMAP_H
+#define AISDI_MAPS_FROZENTREEMAP_H
+
+#include "TreeMap.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace aisdi
+{
+
+	// Allocates blocks that start on a cache line, keeping the bytes in front of the block to remember
+	// where the allocation really began.
+	template <typename Type>
+	class CacheLineAllocator {
+	public:
+		using value_type = Type;
+
+		static const std::size_t LINE_SIZE = 64;
+
+		CacheLineAllocator()
+		{}
+
+		template <typename Other>
+		CacheLineAllocator(const CacheLineAllocator<Other>&)
+		{}
+
+		Type* allocate(std::size_t count)
+		{
+			if (count > (static_cast<std::size_t>(-1) - LINE_SIZE - sizeof(void*)) / sizeof(Type)) {
+				throw std::bad_alloc();
+			}
+			char* raw = static_cast<char*>(::operator new(count * sizeof(Type) + LINE_SIZE + sizeof(void*)));
+			std::uintptr_t address = reinterpret_cast<std::uintptr_t>(raw + sizeof(void*));
+			char* block = raw + sizeof(void*) + (LINE_SIZE - address % LINE_SIZE) % LINE_SIZE;
+			reinterpret_cast<void**>(block)[-1] = raw;
+			return reinterpret_cast<Type*>(block);
+		}
+
+		void deallocate(Type* block, std::size_t)
+		{
+			::operator delete(reinterpret_cast<void**>(block)[-1]);
+		}
+
+		template <typename Other>
+		bool operator==(const CacheLineAllocator<Other>&) const
+		{
+			return true;
+		}
+
+		template <typename Other>
+		bool operator!=(const CacheLineAllocator<Other>&) const
+		{
+			return false;
+		}
+	};
+
+	// Read-only ordered map built once from sorted data. Keys are laid out in Eytzinger (breadth-first)
+	// order: the children of slot k are 2k and 2k+1, so the top of the implicit tree shares a few cache
+	// lines and the descent can prefetch the next levels before it needs them. The elements themselves
+	// stay in key order for iteration.
+	template <typename KeyType, typename ValueType, typename Compare = std::less<KeyType>>
+	class FrozenTreeMap {
+	public:
+		using key_type = KeyType;
+		using mapped_type = ValueType;
+		using value_type = std::pair<const key_type, mapped_type>;
+		using size_type = std::size_t;
+		using reference = value_type&;
+		using const_reference = const value_type&;
+		using key_compare = Compare;
+
+		class ConstIterator;
+		using iterator = ConstIterator;
+		using const_iterator = ConstIterator;
+
+		FrozenTreeMap()
+			: FrozenTreeMap(Compare())
+		{}
+
+		explicit FrozenTreeMap(const Compare& comp)
+			: comp(comp)
+		{}
+
+		explicit FrozenTreeMap(const TreeMap<key_type, mapped_type, Compare>& source)
+			: comp(source.keyComp())
+		{
+			elements.reserve(source.getSize());
+			for (auto it = source.begin(); it != source.end(); ++it) {
+				elements.push_back(*it);
+			}
+			build();
+		}
+
+		// range must be strictly ascending by key
+		template <typename InputIt>
+		static FrozenTreeMap fromSorted(InputIt from, InputIt to, const Compare& comp = Compare())
+		{
+			FrozenTreeMap result(comp);
+			for (; from != to; ++from) {
+				if (!result.elements.empty() && !comp(result.elements.back().first, from->first)) {
+					throw std::invalid_argument("range is not strictly ascending by key");
+				}
+				result.elements.push_back(*from);
+			}
+			result.build();
+			return result;
+		}
+
+		bool isEmpty() const
+		{
+			return elements.empty();
+		}
+
+		size_type getSize() const
+		{
+			return elements.size();
+		}
+
+		const mapped_type& valueOf(const key_type& key) const
+		{
+			const_iterator search = find(key);
+			if (search == cend()) {
+				throw std::out_of_range("cannot access non-existent element");
+			}
+			return search->second;
+		}
+
+		const_iterator find(const key_type& key) const
+		{
+			size_type index = lowerBoundIndex(key);
+			if (index != elements.size() && comp(key, elements[index].first)) {
+				index = elements.size();
+			}
+			return const_iterator(*this, index);
+		}
+
+		const_iterator lowerBound(const key_type& key) const
+		{
+			return const_iterator(*this, lowerBoundIndex(key));
+		}
+
+		const_iterator upperBound(const key_type& key) const
+		{
+			return const_iterator(*this, upperBoundIndex(key));
+		}
+
+		key_compare keyComp() const
+		{
+			return comp;
+		}
+
+		bool operator==(const FrozenTreeMap& other) const
+		{
+			return elements == other.elements;
+		}
+
+		bool operator!=(const FrozenTreeMap& other) const
+		{
+			return !(*this == other);
+		}
+
+		const_iterator cbegin() const
+		{
+			return const_iterator(*this, 0);
+		}
+
+		const_iterator cend() const
+		{
+			return const_iterator(*this, elements.size());
+		}
+
+		const_iterator begin() const
+		{
+			return cbegin();
+		}
+
+		const_iterator end() const
+		{
+			return cend();
+		}
+
+	private:
+		// keys[k] is slot k of the implicit tree (keys[0] is an unused copy of the first key), ranks[k - 1]
+		// is its position in elements
+		std::vector<key_type, CacheLineAllocator<key_type>> keys;
+		std::vector<size_type> ranks;
+		std::vector<value_type> elements;
+		Compare comp;
+
+		static const unsigned PREFETCH_DEPTH = sizeof(key_type) <= 4 ? 4 : sizeof(key_type) <= 8 ? 3 : 2;
+
+		void build()
+		{
+			// an in-order walk of the implicit tree visits the slots in key order
+			ranks.assign(elements.size(), 0);
+			size_type rank = 0;
+			size_type k = 1;
+			std::vector<size_type> stack;
+			while (k <= elements.size() || !stack.empty()) {
+				for (; k <= elements.size(); k = 2 * k) {
+					stack.push_back(k);
+				}
+				k = stack.back();
+				stack.pop_back();
+				ranks[k - 1] = rank++;
+				k = 2 * k + 1;
+			}
+
+			keys.clear();
+			if (elements.empty()) {
+				return;
+			}
+			keys.reserve(elements.size() + 1);
+			keys.push_back(elements[ranks[0]].first);
+			for (size_type position : ranks) {
+				keys.push_back(elements[position].first);
+			}
+		}
+
+		// k encodes the turns taken below the answer: the answer is the last slot the descent left
+		// going left, i.e. k with its trailing right turns and one more bit shifted out
+		size_type resolve(size_type k) const
+		{
+			k >>= trailingOnes(k) + 1;
+			return k == 0 ? elements.size() : ranks[k - 1];
+		}
+
+		size_type lowerBoundIndex(const key_type& key) const
+		{
+			size_type k = 1;
+			while (k < keys.size()) {
+				prefetch(k);
+				k = 2 * k + comp(keys[k], key);
+			}
+			return resolve(k);
+		}
+
+		size_type upperBoundIndex(const key_type& key) const
+		{
+			size_type k = 1;
+			while (k < keys.size()) {
+				prefetch(k);
+				k = 2 * k + !comp(key, keys[k]);
+			}
+			return resolve(k);
+		}
+
+		// descendants of k that are PREFETCH_DEPTH levels down are adjacent, starting at slot
+		// k << PREFETCH_DEPTH; as the keys start on a cache line, for keys of up to 16 bytes with a
+		// power-of-two size the group is one whole line, so a single request covers every path the
+		// descent can take that far. Other keys need a request for every line the group touches.
+		void prefetch(size_type k) const
+		{
+#if defined(__GNUC__)
+			size_type descendant = k << PREFETCH_DEPTH;
+			if (descendant < keys.size()) {
+				const std::uintptr_t line = CacheLineAllocator<key_type>::LINE_SIZE;
+				std::uintptr_t first = reinterpret_cast<std::uintptr_t>(&keys[descendant]);
+				std::uintptr_t last = first + (sizeof(key_type) << PREFETCH_DEPTH) - 1;
+				for (std::uintptr_t address = first & ~(line - 1); address <= last; address += line) {
+					__builtin_prefetch(reinterpret_cast<const void*>(address));
+				}
+			}
+#else
+			(void)k;
+#endif
+		}
+
+		static unsigned trailingOnes(size_type value)
+		{
+#if defined(__GNUC__)
+			return __builtin_ctzll(~static_cast<unsigned long long>(value));
+#else
+			unsigned count = 0;
+			for (; value & 1; value >>= 1) {
+				++count;
+			}
+			return count;
+#endif
+		}
+	};
+
+	template <typename KeyType, typename ValueType, typename Compare>
+	class FrozenTreeMap<KeyType, ValueType, Compare>::ConstIterator {
+	public:
+		using reference = typename FrozenTreeMap::const_reference;
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = typename FrozenTreeMap::value_type;
+		using pointer = const typename FrozenTreeMap::value_type*;
+
+		friend class FrozenTreeMap;
+
+		explicit ConstIterator(const FrozenTreeMap& parent, size_type index)
+			: parent(&parent)
+			, index(index)
+		{}
+
+		ConstIterator& operator++()
+		{
+			if (index == parent->elements.size()) {
+				throw std::out_of_range("cannot increment end() iterator");
+			}
+
+			++index;
+			return *this;
+		}
+
+		ConstIterator operator++(int)
+		{
+			ConstIterator copy = *this;
+			++(*this);
+			return copy;
+		}
+
+		ConstIterator& operator--()
+		{
+			if (index == 0) {
+				throw std::out_of_range("cannot decrement begin() iterator");
+			}
+
+			--index;
+			return *this;
+		}
+
+		ConstIterator operator--(int)
+		{
+			ConstIterator copy = *this;
+			--(*this);
+			return copy;
+		}
+
+		reference operator*() const
+		{
+			if (index == parent->elements.size()) {
+				throw std::out_of_range("cannot dereference end() iterator");
+			}
+
+			return parent->elements[index];
+		}
+
+		pointer operator->() const
+		{
+			return &this->operator*();
+		}
+
+		bool operator==(const ConstIterator& other) const
+		{
+			return index == other.index;
+		}
+
+		bool operator!=(const ConstIterator& other) const
+		{
+			return !(*this == other);
+		}
+
+	private:
+		const FrozenTreeMap* parent;
+		size_type index;
+	};
+
+}
+
+#endif /* AISDI_MAPS_FROZENTREEMAP_H */
@@ -2,15 +2,28 @@
 #define AISDI_MAPS_HASHMAP_H
 
 #include "LinkedList.h"
+#include "MapStats.h"
+#include "ThreadPool.h"
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <initializer_list>
+#include <limits>
+#include <memory>
+#include <new>
 #include <stdexcept>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace aisdi
 {
 
-	template <typename KeyType, typename ValueType>
+	// Separate chaining over an array of LinkedList buckets that doubles once the map holds more
+	// elements than buckets, so chains stay O(1) long. Rehashing relinks the list nodes instead of
+	// copying elements. Integral keys get the open addressing specialization below.
+	template <typename KeyType, typename ValueType, typename Enable = void>
 	class HashMap {
 	public:
 		using key_type = KeyType;
@@ -26,7 +39,8 @@ namespace aisdi
 		using const_iterator = ConstIterator;
 
 		HashMap()
-			: data(new LinkedList<value_type>[BUCKET_COUNT])
+			: data(new LinkedList<value_type>[MIN_BUCKET_COUNT])
+			, bucket_count(MIN_BUCKET_COUNT)
 			, size(0)
 		{}
 
@@ -46,11 +60,14 @@ namespace aisdi
 			}
 		}
 
-		HashMap(HashMap&& other)
+		// the moved-from map is left without buckets; the next insertion allocates them
+		HashMap(HashMap&& other) noexcept
 			: data(other.data)
+			, bucket_count(other.bucket_count)
 			, size(other.size)
 		{
 			other.data = nullptr;
+			other.bucket_count = 0;
 			other.size = 0;
 		}
 
@@ -62,9 +79,11 @@ namespace aisdi
 		HashMap& operator=(const HashMap& other)
 		{
 			if (this != &other) {
+				// the first insert allocates new buckets
 				size = 0;
 				delete[] data;
-				data = new LinkedList<value_type>[BUCKET_COUNT];
+				data = nullptr;
+				bucket_count = 0;
 				for (const auto& it : other) {
 					insert(it.first, it.second);
 				}
@@ -72,13 +91,15 @@ namespace aisdi
 			return *this;
 		}
 
-		HashMap& operator=(HashMap&& other)
+		HashMap& operator=(HashMap&& other) noexcept
 		{
 			if (this != &other) {
 				delete[] data;
 				data = other.data;
+				bucket_count = other.bucket_count;
 				size = other.size;
 				other.data = nullptr;
+				other.bucket_count = 0;
 				other.size = 0;
 			}
 			return *this;
@@ -114,11 +135,16 @@ namespace aisdi
 
 		const_iterator find(const key_type& key) const
 		{
+			counters.lookup();
+			if (bucket_count == 0) {
+				return cend();
+			}
 			size_type bucket = getBucket(key);
-			size_type i = 0;
-			for (auto it = data[bucket].begin(); it != data[bucket].end(); ++it, ++i) {
+			const LinkedList<value_type>& chain = data[bucket];
+			for (auto it = chain.cbegin(); it != chain.cend(); ++it) {
+				counters.comparison();
 				if (it->first == key) {
-					return const_iterator(*this, bucket, i);
+					return const_iterator(*this, bucket, it);
 				}
 			}
 			return cend();
@@ -126,14 +152,7 @@ namespace aisdi
 
 		iterator find(const key_type& key)
 		{
-			size_type bucket = getBucket(key);
-			size_type i = 0;
-			for (auto it = data[bucket].begin(); it != data[bucket].end(); ++it, ++i) {
-				if (it->first == key) {
-					return iterator(*this, bucket, i);
-				}
-			}
-			return end();
+			return static_cast<const HashMap&>(*this).find(key);
 		}
 
 		void remove(const key_type& key)
@@ -141,20 +160,20 @@ namespace aisdi
 			if (isEmpty()) {
 				throw std::out_of_range("cannot remove from empty map");
 			}
-			size_type bucket = getBucket(key);
-			for (auto it = data[bucket].begin(); it != data[bucket].end(); ++it) {
-				if (it->first == key) {
-					data[bucket].erase(it);
-					--size;
-					return;
-				}
+			const_iterator search = find(key);
+			if (search == cend()) {
+				throw std::out_of_range("cannot remove element with non-existent key");
 			}
-			throw std::out_of_range("cannot remove element with non-existent key");
+			erase(search);
 		}
 
+		// unlinks the element's node directly, without searching its chain again
 		void remove(const const_iterator& it)
 		{
-			remove(it->first);
+			if (it.parent != this || it == cend()) {
+				throw std::out_of_range("cannot remove element with non-existent key");
+			}
+			erase(it);
 		}
 
 		size_type getSize() const
@@ -162,24 +181,106 @@ namespace aisdi
 			return size;
 		}
 
+		// one pass over the buckets; a successful lookup compares the keys up to its own position in
+		// the chain, an unsuccessful one every key in the chain
+		HashMapStats stats() const
+		{
+			HashMapStats result = HashMapStats();
+			result.size = size;
+			result.bucket_count = bucket_count;
+			result.operations = counters.get();
+			if (bucket_count == 0) {
+				return result;
+			}
+			size_type empty = 0;
+			double hit_probes = 0;
+			for (size_type i = 0; i < bucket_count; ++i) {
+				size_type length = data[i].getSize();
+				if (length >= result.bucket_lengths.size()) {
+					result.bucket_lengths.resize(length + 1);
+				}
+				++result.bucket_lengths[length];
+				result.max_chain = std::max(result.max_chain, length);
+				empty += length == 0;
+				hit_probes += length * (length + 1) / 2.0;
+			}
+			result.empty_bucket_ratio = static_cast<double>(empty) / bucket_count;
+			result.average_probes_hit = size != 0 ? hit_probes / size : 0;
+			result.average_probes_miss = static_cast<double>(size) / bucket_count;
+			return result;
+		}
+
+		void resetCounters()
+		{
+			counters.reset();
+		}
+
+		// calls fn on every element; buckets are split into PARALLEL_CHUNKS ranges run on the pool
+		template <typename Function>
+		void parallelForEach(ThreadPool& pool, Function fn)
+		{
+			pool.parallelFor(PARALLEL_CHUNKS, [this, &fn](size_type chunk) {
+				for (size_type i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i) {
+					for (auto& item : data[i]) {
+						fn(item);
+					}
+				}
+			});
+		}
+
+		template <typename Function>
+		void parallelForEach(ThreadPool& pool, Function fn) const
+		{
+			pool.parallelFor(PARALLEL_CHUNKS, [this, &fn](size_type chunk) {
+				for (size_type i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i) {
+					for (const auto& item : static_cast<const LinkedList<value_type>&>(data[i])) {
+						fn(item);
+					}
+				}
+			});
+		}
+
+		// folds map(element) with an associative combine; chunks are combined in iteration order,
+		// so the result does not depend on the pool size or scheduling
+		template <typename Result, typename Map, typename Combine>
+		Result parallelReduce(ThreadPool& pool, Result init, Map map, Combine combine) const
+		{
+			std::vector<std::unique_ptr<Result>> partials(PARALLEL_CHUNKS);
+			pool.parallelFor(PARALLEL_CHUNKS, [this, &partials, &map, &combine](size_type chunk) {
+				std::unique_ptr<Result> partial;
+				for (size_type i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i) {
+					for (const auto& item : static_cast<const LinkedList<value_type>&>(data[i])) {
+						if (partial) {
+							*partial = combine(std::move(*partial), map(item));
+						}
+						else {
+							partial.reset(new Result(map(item)));
+						}
+					}
+				}
+				partials[chunk] = std::move(partial);
+			});
+
+			for (auto& partial : partials) {
+				if (partial) {
+					init = combine(std::move(init), std::move(*partial));
+				}
+			}
+			return init;
+		}
+
+		// chain order depends on the insertion and growth history, so elements are matched by key
 		bool operator==(const HashMap& other) const
 		{
 			if (size != other.size) {
 				return false;
 			}
 
-			for (size_type i = 0; i < BUCKET_COUNT; ++i) {
-				if (data[i].getSize() != other.data[i].getSize()) {
+			for (const auto& it : *this) {
+				const_iterator search = other.find(it.first);
+				if (search == other.cend() || search->second != it.second) {
 					return false;
 				}
-
-				auto it_this = data[i].begin();
-				auto it_other = other.data[i].begin();
-				for (; it_this != data[i].end(); ++it_this, ++it_other) {
-					if (*it_this != *it_other) {
-						return false;
-					}
-				}
 			}
 			return true;
 		}
@@ -191,32 +292,27 @@ namespace aisdi
 
 		iterator begin()
 		{
-			for (size_type i = 0; i < BUCKET_COUNT; ++i) {
-				if (data[i].getSize() != 0) {
-					return iterator(*this, i, 0);
-				}
-			}
-			return iterator(*this, BUCKET_COUNT - 1, 0);
+			return cbegin();
 		}
 
 		iterator end()
 		{
-			return iterator(*this, BUCKET_COUNT - 1, data[BUCKET_COUNT - 1].getSize());
+			return cend();
 		}
 
 		const_iterator cbegin() const
 		{
-			for (size_type i = 0; i < BUCKET_COUNT; ++i) {
+			for (size_type i = 0; i < bucket_count; ++i) {
 				if (data[i].getSize() != 0) {
-					return const_iterator(*this, i, 0);
+					return const_iterator(*this, i, data[i].cbegin());
 				}
 			}
-			return const_iterator(*this, BUCKET_COUNT - 1, 0);
+			return cend();
 		}
 
 		const_iterator cend() const
 		{
-			return const_iterator(*this, BUCKET_COUNT - 1, data[BUCKET_COUNT - 1].getSize());
+			return const_iterator(*this, bucket_count, ChainIterator());
 		}
 
 		const_iterator begin() const
@@ -230,13 +326,23 @@ namespace aisdi
 		}
 
 	private:
-		static const size_type BUCKET_COUNT = 10000;
+		using ChainIterator = typename LinkedList<value_type>::const_iterator;
+
+		static const size_type MIN_BUCKET_COUNT = 10000;
+		static const size_type PARALLEL_CHUNKS = 64;
 		LinkedList<value_type>* data;
+		size_type bucket_count;
 		size_type size;
+		OperationCounters counters;
+
+		size_type chunkBegin(size_type chunk) const
+		{
+			return bucket_count * chunk / PARALLEL_CHUNKS;
+		}
 
 		size_type getBucket(const key_type& key) const
 		{
-			return std::hash<key_type>{}(key) % BUCKET_COUNT;
+			return std::hash<key_type>{}(key) % bucket_count;
 		}
 
 		iterator insert(const key_type& key, const mapped_type& value)
@@ -246,96 +352,124 @@ namespace aisdi
 				return search;
 			}
 
+			// at most one element per bucket on average; growing only here keeps references valid
+			// as long as nothing is inserted
+			if (bucket_count == 0) {
+				data = new LinkedList<value_type>[MIN_BUCKET_COUNT];
+				bucket_count = MIN_BUCKET_COUNT;
+			}
+			else if (size + 1 > bucket_count) {
+				rehash(bucket_count * 2);
+			}
 			size_type bucket = getBucket(key);
 			data[bucket].append(std::make_pair(key, value));
 			++size;
-			return iterator(*this, bucket, data[bucket].getSize() - 1);
+			counters.insertion();
+			return iterator(*this, bucket, --data[bucket].cend());
+		}
+
+		void erase(const const_iterator& it)
+		{
+			data[it.bucket].erase(it.node);
+			--size;
+			counters.removal();
+		}
+
+		// moves every node into its bucket of a new array; elements are neither copied nor moved
+		void rehash(size_type new_bucket_count)
+		{
+			LinkedList<value_type>* buckets = new LinkedList<value_type>[new_bucket_count];
+			LinkedList<value_type>* old = data;
+			size_type old_count = bucket_count;
+			data = buckets;
+			bucket_count = new_bucket_count;
+			for (size_type i = 0; i < old_count; ++i) {
+				while (!old[i].isEmpty()) {
+					ChainIterator node = old[i].cbegin();
+					LinkedList<value_type>& chain = data[getBucket(node->first)];
+					chain.splice(chain.cend(), old[i], node);
+				}
+			}
+			delete[] old;
 		}
 	};
 
-	template <typename KeyType, typename ValueType>
-	class HashMap<KeyType, ValueType>::ConstIterator {
+	template <typename KeyType, typename ValueType, typename Enable>
+	class HashMap<KeyType, ValueType, Enable>::ConstIterator {
 	public:
 		using reference = typename HashMap::const_reference;
 		using iterator_category = std::bidirectional_iterator_tag;
 		using value_type = typename HashMap::value_type;
 		using pointer = const typename HashMap::value_type*;
 
-		explicit ConstIterator(const HashMap& parent, size_type bucket, size_type index)
-			: parent(parent)
-			, bucket(bucket)
-			, index(index)
-		{}
+		friend class HashMap;
 
-		ConstIterator(const ConstIterator& other)
-			: parent(other.parent)
-			, bucket(other.bucket)
-			, index(other.index)
+		// the node of the element in its bucket's chain; end() is past the last bucket
+		explicit ConstIterator(const HashMap& parent, size_type bucket, ChainIterator node)
+			: parent(&parent)
+			, bucket(bucket)
+			, node(node)
 		{}
 
 		ConstIterator& operator++()
 		{
-			if (*this == parent.end()) {
+			if (bucket == parent->bucket_count) {
 				throw std::out_of_range("cannot increment end() iterator");
 			}
 
-			if (++index != parent.data[bucket].getSize()) {
+			if (++node != parent->data[bucket].cend()) {
 				return *this;
 			}
 
-			for (size_type i = bucket + 1; i < BUCKET_COUNT; ++i) {
-				if (parent.data[i].getSize() != 0) {
+			for (size_type i = bucket + 1; i < parent->bucket_count; ++i) {
+				if (parent->data[i].getSize() != 0) {
 					bucket = i;
-					index = 0;
+					node = parent->data[i].cbegin();
 					return *this;
 				}
 			}
 
-			bucket = BUCKET_COUNT - 1;
-			index = parent.data[bucket].getSize();
+			*this = parent->cend();
 			return *this;
 		}
 
 		ConstIterator operator++(int)
 		{
-			ConstIterator copy = *this;
-			++(*this);
+			ConstIterator copy = *this;
+			++(*this);
 			return copy;
 		}
 
 		ConstIterator& operator--()
 		{
-			if (*this == parent.begin()) {
-				throw std::out_of_range("cannot decrement begin() iterator");
-			}
-
-			if (index != 0) {
-				--index;
+			if (bucket != parent->bucket_count && node != parent->data[bucket].cbegin()) {
+				--node;
 				return *this;
 			}
 
-			for (size_type i = bucket - 1; /*i >= 0*/; --i) {
-				if (parent.data[i].getSize() != 0) {
-					bucket = i;
-					index = parent.data[bucket].getSize() - 1;
+			for (size_type i = bucket; i != 0; --i) {
+				if (parent->data[i - 1].getSize() != 0) {
+					bucket = i - 1;
+					node = --parent->data[bucket].cend();
 					return *this;
 				}
 			}
+			throw std::out_of_range("cannot decrement begin() iterator");
 		}
 
 		ConstIterator operator--(int)
 		{
-			ConstIterator copy = *this;
-			--(*this);
+			ConstIterator copy = *this;
+			--(*this);
 			return copy;
 		}
 
 		reference operator*() const
 		{
-			if (index >= parent.data[bucket].getSize()) {
+			if (bucket == parent->bucket_count) {
 				throw std::out_of_range("cannot dereference end() iterator");
 			}
-			return *(parent.data[bucket].begin() + index);
+			return *node;
 		}
 
 		pointer operator->() const
@@ -345,7 +479,7 @@ namespace aisdi
 
 		bool operator==(const ConstIterator& other) const
 		{
-			return (&parent == &other.parent && bucket == other.bucket && index == other.index);
+			return parent == other.parent && bucket == other.bucket && node == other.node;
 		}
 
 		bool operator!=(const ConstIterator& other) const
@@ -354,19 +488,710 @@ namespace aisdi
 		}
 
 	protected:
-		const HashMap& parent;
+		const HashMap* parent;
 		size_type bucket;
-		size_type index;
+		ChainIterator node;
+	};
+
+	template <typename KeyType, typename ValueType, typename Enable>
+	class HashMap<KeyType, ValueType, Enable>::Iterator : public HashMap<KeyType, ValueType, Enable>::ConstIterator {
+	public:
+		using reference = typename HashMap::reference;
+		using pointer = typename HashMap::value_type*;
+
+		explicit Iterator(const HashMap& parent, size_type bucket, ChainIterator node)
+			: ConstIterator(parent, bucket, node)
+		{}
+
+		Iterator(const ConstIterator& other)
+			: ConstIterator(other)
+		{}
+
+		Iterator& operator++()
+		{
+			ConstIterator::operator++();
+			return *this;
+		}
+
+		Iterator operator++(int)
+		{
+			auto result = *this;
+			ConstIterator::operator++();
+			return result;
+		}
+
+		Iterator& operator--()
+		{
+			ConstIterator::operator--();
+			return *this;
+		}
+
+		Iterator operator--(int)
+		{
+			auto result = *this;
+			ConstIterator::operator--();
+			return result;
+		}
+
+		pointer operator->() const
+		{
+			return &this->operator*();
+		}
+
+		reference operator*() const
+		{
+			// ugly cast, yet reduces code duplication.
+			return const_cast<reference>(ConstIterator::operator*());
+		}
+	};
+
+	// Open addressing for integral keys: a power-of-two table probed linearly from a Fibonacci hash,
+	// keys kept unboxed in their own array so a probe touches only that array. Two key values mark
+	// empty and removed slots; the elements that really have those keys live in two extra slots
+	// past the end of the table.
+	template <typename KeyType, typename ValueType>
+	class HashMap<KeyType, ValueType, typename std::enable_if<std::is_integral<KeyType>::value
+		&& !std::is_same<KeyType, bool>::value>::type> {
+	public:
+		using key_type = KeyType;
+		using mapped_type = ValueType;
+		using value_type = std::pair<const key_type, mapped_type>;
+		using size_type = std::size_t;
+		using reference = value_type&;
+		using const_reference = const value_type&;
+
+		class ConstIterator;
+		class Iterator;
+		using iterator = Iterator;
+		using const_iterator = ConstIterator;
+
+		HashMap()
+			: keys(nullptr)
+			, slots(nullptr)
+			, capacity(0)
+			, size(0)
+			, tombstones(0)
+			, shift(64)
+		{
+			allocate(MIN_CAPACITY);
+		}
+
+		HashMap(std::initializer_list<value_type> list)
+			: HashMap()
+		{
+			for (auto&& it : list) {
+				insert(it.first, it.second);
+			}
+		}
+
+		HashMap(const HashMap& other)
+			: HashMap()
+		{
+			for (const auto& it : other) {
+				insert(it.first, it.second);
+			}
+		}
+
+		// the moved-from map is left without a table; the next insertion allocates one
+		HashMap(HashMap&& other) noexcept
+			: keys(other.keys)
+			, slots(other.slots)
+			, capacity(other.capacity)
+			, size(other.size)
+			, tombstones(other.tombstones)
+			, shift(other.shift)
+		{
+			special[0] = other.special[0];
+			special[1] = other.special[1];
+			other.keys = nullptr;
+			other.slots = nullptr;
+			other.capacity = 0;
+			other.size = 0;
+			other.tombstones = 0;
+			other.special[0] = false;
+			other.special[1] = false;
+		}
+
+		~HashMap()
+		{
+			release();
+		}
+
+		HashMap& operator=(const HashMap& other)
+		{
+			if (this != &other) {
+				release();
+				allocate(MIN_CAPACITY);
+				for (const auto& it : other) {
+					insert(it.first, it.second);
+				}
+			}
+			return *this;
+		}
+
+		HashMap& operator=(HashMap&& other) noexcept
+		{
+			if (this != &other) {
+				release();
+				keys = other.keys;
+				slots = other.slots;
+				capacity = other.capacity;
+				size = other.size;
+				tombstones = other.tombstones;
+				shift = other.shift;
+				special[0] = other.special[0];
+				special[1] = other.special[1];
+				other.keys = nullptr;
+				other.slots = nullptr;
+				other.capacity = 0;
+				other.size = 0;
+				other.tombstones = 0;
+				other.special[0] = false;
+				other.special[1] = false;
+			}
+			return *this;
+		}
+
+		bool isEmpty() const
+		{
+			return !size;
+		}
+
+		mapped_type& operator[](const key_type& key)
+		{
+			// insert may reallocate slots, so it has to run before slots is read
+			size_type slot = insert(key, mapped_type());
+			return slots[slot].second;
+		}
+
+		const mapped_type& valueOf(const key_type& key) const
+		{
+			size_type slot = findSlot(key);
+			if (slot == endSlot()) {
+				throw std::out_of_range("cannot access non-existent element");
+			}
+			return slots[slot].second;
+		}
+
+		mapped_type& valueOf(const key_type& key)
+		{
+			size_type slot = findSlot(key);
+			if (slot == endSlot()) {
+				throw std::out_of_range("cannot access non-existent element");
+			}
+			return slots[slot].second;
+		}
+
+		const_iterator find(const key_type& key) const
+		{
+			return const_iterator(*this, findSlot(key));
+		}
+
+		iterator find(const key_type& key)
+		{
+			return iterator(*this, findSlot(key));
+		}
+
+		void remove(const key_type& key)
+		{
+			if (isEmpty()) {
+				throw std::out_of_range("cannot remove from empty map");
+			}
+			size_type slot = findSlot(key);
+			if (slot == endSlot()) {
+				throw std::out_of_range("cannot remove element with non-existent key");
+			}
+			erase(slot);
+		}
+
+		void remove(const const_iterator& it)
+		{
+			remove(it->first);
+		}
+
+		size_type getSize() const
+		{
+			return size;
+		}
+
+		// One pass over the table. Probe runs stop only at empty slots, so the runs of non-empty ones
+		// (tombstones included) play the part of chains, and a search starting inside a run compares
+		// every key up to the end of it when the key is missing. The two special slots count as one
+		// probe each.
+		HashMapStats stats() const
+		{
+			HashMapStats result = HashMapStats();
+			result.size = size;
+			result.bucket_count = capacity;
+			result.operations = counters.get();
+			if (capacity == 0) {
+				return result;
+			}
+
+			// the table is never full, so walking backwards from an empty slot sees every run whole
+			size_type mask = capacity - 1;
+			size_type start = 0;
+			while (keys[start] != emptyKey()) {
+				++start;
+			}
+			size_type empty = 0;
+			size_type run = 0;
+			double hit_probes = 0;
+			double miss_probes = 0;
+			for (size_type step = 1; step <= capacity; ++step) {
+				size_type i = (start + capacity - step) & mask;
+				if (keys[i] == emptyKey()) {
+					++empty;
+					addRun(result, run);
+					run = 0;
+					continue;
+				}
+				++run;
+				miss_probes += run;
+				if (keys[i] != tombstoneKey()) {
+					hit_probes += ((i - hash(keys[i])) & mask) + 1;
+				}
+			}
+			addRun(result, run);
+			hit_probes += special[0] + special[1];
+
+			result.empty_bucket_ratio = static_cast<double>(empty) / capacity;
+			result.average_probes_hit = size != 0 ? hit_probes / size : 0;
+			result.average_probes_miss = miss_probes / capacity;
+			return result;
+		}
+
+		void resetCounters()
+		{
+			counters.reset();
+		}
+
+		// calls fn on every element; slots are split into PARALLEL_CHUNKS ranges run on the pool
+		template <typename Function>
+		void parallelForEach(ThreadPool& pool, Function fn)
+		{
+			pool.parallelFor(PARALLEL_CHUNKS, [this, &fn](size_type chunk) {
+				for (size_type i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i) {
+					if (occupied(i)) {
+						fn(slots[i]);
+					}
+				}
+			});
+		}
+
+		template <typename Function>
+		void parallelForEach(ThreadPool& pool, Function fn) const
+		{
+			pool.parallelFor(PARALLEL_CHUNKS, [this, &fn](size_type chunk) {
+				for (size_type i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i) {
+					if (occupied(i)) {
+						fn(static_cast<const_reference>(slots[i]));
+					}
+				}
+			});
+		}
+
+		// folds map(element) with an associative combine; chunks are combined in iteration order,
+		// so the result does not depend on the pool size or scheduling
+		template <typename Result, typename Map, typename Combine>
+		Result parallelReduce(ThreadPool& pool, Result init, Map map, Combine combine) const
+		{
+			std::vector<std::unique_ptr<Result>> partials(PARALLEL_CHUNKS);
+			pool.parallelFor(PARALLEL_CHUNKS, [this, &partials, &map, &combine](size_type chunk) {
+				std::unique_ptr<Result> partial;
+				for (size_type i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i) {
+					if (!occupied(i)) {
+						continue;
+					}
+					if (partial) {
+						*partial = combine(std::move(*partial), map(static_cast<const_reference>(slots[i])));
+					}
+					else {
+						partial.reset(new Result(map(static_cast<const_reference>(slots[i]))));
+					}
+				}
+				partials[chunk] = std::move(partial);
+			});
+
+			for (auto& partial : partials) {
+				if (partial) {
+					init = combine(std::move(init), std::move(*partial));
+				}
+			}
+			return init;
+		}
+
+		// slot order depends on the insertion history, so elements are matched by key
+		bool operator==(const HashMap& other) const
+		{
+			if (size != other.size) {
+				return false;
+			}
+
+			for (const auto& it : *this) {
+				size_type slot = other.findSlot(it.first);
+				if (slot == other.endSlot() || other.slots[slot].second != it.second) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool operator!=(const HashMap& other) const
+		{
+			return !(*this == other);
+		}
+
+		iterator begin()
+		{
+			return iterator(*this, nextOccupied(0));
+		}
+
+		iterator end()
+		{
+			return iterator(*this, endSlot());
+		}
+
+		const_iterator cbegin() const
+		{
+			return const_iterator(*this, nextOccupied(0));
+		}
+
+		const_iterator cend() const
+		{
+			return const_iterator(*this, endSlot());
+		}
+
+		const_iterator begin() const
+		{
+			return cbegin();
+		}
+
+		const_iterator end() const
+		{
+			return cend();
+		}
+
+	private:
+		static const size_type MIN_CAPACITY = 16;
+		static const size_type PARALLEL_CHUNKS = 64;
+
+		// capacity slots in the table, then the slots for the keys equal to the empty and tombstone markers
+		// (no table at all, keys == nullptr and capacity == 0, after the map was moved from)
+		key_type* keys;
+		value_type* slots;
+		size_type capacity;
+		size_type size;
+		size_type tombstones;
+		// 64 - log2(capacity)
+		unsigned shift;
+		bool special[2];
+		std::allocator<value_type> allocator;
+		OperationCounters counters;
+
+		static key_type emptyKey()
+		{
+			return std::numeric_limits<key_type>::max();
+		}
+
+		static key_type tombstoneKey()
+		{
+			return static_cast<key_type>(std::numeric_limits<key_type>::max() - 1);
+		}
+
+		size_type endSlot() const
+		{
+			return capacity + 2;
+		}
+
+		size_type chunkBegin(size_type chunk) const
+		{
+			return endSlot() * chunk / PARALLEL_CHUNKS;
+		}
+
+		// Fibonacci hashing: the top bits of key * 2^64/phi spread consecutive and strided keys evenly
+		size_type hash(key_type key) const
+		{
+			return static_cast<size_type>((static_cast<std::uint64_t>(key) * 0x9E3779B97F4A7C15ull) >> shift);
+		}
+
+		static void addRun(HashMapStats& stats, size_type run)
+		{
+			if (run == 0) {
+				return;
+			}
+			if (run >= stats.bucket_lengths.size()) {
+				stats.bucket_lengths.resize(run + 1);
+			}
+			++stats.bucket_lengths[run];
+			stats.max_chain = std::max(stats.max_chain, run);
+		}
+
+		bool occupied(size_type slot) const
+		{
+			if (slot < capacity) {
+				return keys[slot] != emptyKey() && keys[slot] != tombstoneKey();
+			}
+			return special[slot - capacity];
+		}
+
+		size_type nextOccupied(size_type slot) const
+		{
+			while (slot != endSlot() && !occupied(slot)) {
+				++slot;
+			}
+			return slot;
+		}
+
+		size_type findSlot(const key_type& key) const
+		{
+			counters.lookup();
+			if (key == emptyKey() || key == tombstoneKey()) {
+				size_type slot = capacity + (key == emptyKey() ? 0 : 1);
+				return special[slot - capacity] ? slot : endSlot();
+			}
+			if (capacity == 0) {
+				return endSlot();
+			}
+
+			size_type mask = capacity - 1;
+			for (size_type i = hash(key); keys[i] != emptyKey(); i = (i + 1) & mask) {
+				counters.comparison();
+				if (keys[i] == key) {
+					return i;
+				}
+			}
+			return endSlot();
+		}
+
+		// returns the slot of key, adding it with value if it is not there yet
+		size_type insert(const key_type& key, const mapped_type& value)
+		{
+			counters.lookup();
+			if (keys == nullptr) {
+				allocate(MIN_CAPACITY);
+			}
+			if (key == emptyKey() || key == tombstoneKey()) {
+				size_type slot = capacity + (key == emptyKey() ? 0 : 1);
+				if (!special[slot - capacity]) {
+					::new (static_cast<void*>(slots + slot)) value_type(key, value);
+					special[slot - capacity] = true;
+					++size;
+					counters.insertion();
+				}
+				return slot;
+			}
+
+			size_type mask = capacity - 1;
+			size_type reuse = endSlot();
+			size_type i = hash(key);
+			for (; keys[i] != emptyKey(); i = (i + 1) & mask) {
+				counters.comparison();
+				if (keys[i] == key) {
+					return i;
+				}
+				if (keys[i] == tombstoneKey() && reuse == endSlot()) {
+					reuse = i;
+				}
+			}
+
+			// only an actual insertion may grow the table, so finding a key keeps references valid;
+			// reusing a tombstone does not add a non-empty slot
+			if (reuse != endSlot()) {
+				i = reuse;
+				--tombstones;
+			}
+			// keep at most 3/4 of the table non-empty so probe runs stay short
+			else if ((size + tombstones + 1) * 4 > capacity * 3) {
+				rehash((size + 1) * 2 > capacity ? capacity * 2 : capacity);
+				mask = capacity - 1;
+				for (i = hash(key); keys[i] != emptyKey(); i = (i + 1) & mask) {}
+			}
+			::new (static_cast<void*>(slots + i)) value_type(key, value);
+			keys[i] = key;
+			++size;
+			counters.insertion();
+			return i;
+		}
+
+		void erase(size_type slot)
+		{
+			slots[slot].~value_type();
+			--size;
+			counters.removal();
+			if (slot >= capacity) {
+				special[slot - capacity] = false;
+			}
+			// no probe run continues past an empty slot, so the tombstone is only needed before one
+			else if (keys[(slot + 1) & (capacity - 1)] == emptyKey()) {
+				keys[slot] = emptyKey();
+			}
+			else {
+				keys[slot] = tombstoneKey();
+				++tombstones;
+			}
+		}
+
+		void allocate(size_type new_capacity)
+		{
+			keys = new key_type[new_capacity];
+			std::fill(keys, keys + new_capacity, emptyKey());
+			slots = allocator.allocate(new_capacity + 2);
+			capacity = new_capacity;
+			tombstones = 0;
+			shift = 64;
+			for (size_type bits = new_capacity; bits > 1; bits >>= 1) {
+				--shift;
+			}
+			special[0] = false;
+			special[1] = false;
+		}
+
+		void destroyElements()
+		{
+			for (size_type i = 0; i < endSlot(); ++i) {
+				if (occupied(i)) {
+					slots[i].~value_type();
+				}
+			}
+		}
+
+		void release()
+		{
+			if (keys != nullptr) {
+				destroyElements();
+				delete[] keys;
+				allocator.deallocate(slots, capacity + 2);
+			}
+			keys = nullptr;
+			slots = nullptr;
+			capacity = 0;
+			size = 0;
+			tombstones = 0;
+			special[0] = false;
+			special[1] = false;
+		}
+
+		// moves every element into a fresh table, dropping the tombstones
+		void rehash(size_type new_capacity)
+		{
+			key_type* old_keys = keys;
+			value_type* old_slots = slots;
+			size_type old_capacity = capacity;
+			bool old_special[2] = { special[0], special[1] };
+
+			allocate(new_capacity);
+			special[0] = old_special[0];
+			special[1] = old_special[1];
+			size_type mask = capacity - 1;
+			for (size_type i = 0; i < old_capacity + 2; ++i) {
+				bool live = i < old_capacity
+					? old_keys[i] != emptyKey() && old_keys[i] != tombstoneKey()
+					: old_special[i - old_capacity];
+				if (!live) {
+					continue;
+				}
+
+				size_type slot = capacity + (i - old_capacity);
+				if (i < old_capacity) {
+					for (slot = hash(old_keys[i]); keys[slot] != emptyKey(); slot = (slot + 1) & mask) {}
+					keys[slot] = old_keys[i];
+				}
+				::new (static_cast<void*>(slots + slot)) value_type(old_slots[i].first, std::move(old_slots[i].second));
+				old_slots[i].~value_type();
+			}
+			delete[] old_keys;
+			allocator.deallocate(old_slots, old_capacity + 2);
+		}
+	};
+
+	template <typename KeyType, typename ValueType>
+	class HashMap<KeyType, ValueType, typename std::enable_if<std::is_integral<KeyType>::value
+		&& !std::is_same<KeyType, bool>::value>::type>::ConstIterator {
+	public:
+		using reference = typename HashMap::const_reference;
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = typename HashMap::value_type;
+		using pointer = const typename HashMap::value_type*;
+
+		explicit ConstIterator(const HashMap& parent, size_type slot)
+			: parent(&parent)
+			, slot(slot)
+		{}
+
+		ConstIterator& operator++()
+		{
+			if (slot == parent->endSlot()) {
+				throw std::out_of_range("cannot increment end() iterator");
+			}
+
+			slot = parent->nextOccupied(slot + 1);
+			return *this;
+		}
+
+		ConstIterator operator++(int)
+		{
+			ConstIterator copy = *this;
+			++(*this);
+			return copy;
+		}
+
+		ConstIterator& operator--()
+		{
+			size_type previous = slot;
+			while (previous != 0) {
+				if (parent->occupied(--previous)) {
+					slot = previous;
+					return *this;
+				}
+			}
+			throw std::out_of_range("cannot decrement begin() iterator");
+		}
+
+		ConstIterator operator--(int)
+		{
+			ConstIterator copy = *this;
+			--(*this);
+			return copy;
+		}
+
+		reference operator*() const
+		{
+			if (slot == parent->endSlot()) {
+				throw std::out_of_range("cannot dereference end() iterator");
+			}
+			return parent->slots[slot];
+		}
+
+		pointer operator->() const
+		{
+			return &this->operator*();
+		}
+
+		bool operator==(const ConstIterator& other) const
+		{
+			return parent == other.parent && slot == other.slot;
+		}
+
+		bool operator!=(const ConstIterator& other) const
+		{
+			return !(*this == other);
+		}
+
+	protected:
+		const HashMap* parent;
+		size_type slot;
 	};
 
 	template <typename KeyType, typename ValueType>
-	class HashMap<KeyType, ValueType>::Iterator : public HashMap<KeyType, ValueType>::ConstIterator {
+	class HashMap<KeyType, ValueType, typename std::enable_if<std::is_integral<KeyType>::value
+		&& !std::is_same<KeyType, bool>::value>::type>::Iterator : public HashMap::ConstIterator {
 	public:
 		using reference = typename HashMap::reference;
 		using pointer = typename HashMap::value_type*;
 
-		explicit Iterator(const HashMap& parent, size_type bucket, size_type index)
-			: ConstIterator(parent, bucket, index)
+		explicit Iterator(const HashMap& parent, size_type slot)
+			: ConstIterator(parent, slot)
 		{}
 
 		Iterator(const ConstIterator& other)
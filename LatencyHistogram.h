@@ -0,0 +1,223 @@
+#ifndef AISDI_LATENCYHISTOGRAM_H
+#define AISDI_LATENCYHISTOGRAM_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace aisdi
+{
+
+	// Counts values in log-linear buckets like HdrHistogram: every power of two is split into
+	// 2^(precision_bits - 1) buckets, so a recorded value is off by less than 2^(1 - precision_bits)
+	// of itself, and values below 2^precision_bits are exact. Recording is a shift and an increment.
+	class LatencyHistogram {
+	public:
+		using size_type = std::size_t;
+
+		explicit LatencyHistogram(unsigned precision_bits = 7)
+			: precision_bits(checkPrecision(precision_bits))
+			, half(size_type(1) << (this->precision_bits - 1))
+			, count(0)
+			, sum(0)
+			, min(std::numeric_limits<std::uint64_t>::max())
+			, max(0)
+		{
+			buckets.assign((64 - precision_bits) * half + 2 * half, 0);
+		}
+
+		void record(std::uint64_t value)
+		{
+			++buckets[index(value)];
+			++count;
+			sum += value;
+			min = std::min(min, value);
+			max = std::max(max, value);
+		}
+
+		// other must have the same precision
+		void merge(const LatencyHistogram& other)
+		{
+			if (other.precision_bits != precision_bits) {
+				throw std::invalid_argument("merging histograms of different precision");
+			}
+			for (size_type i = 0; i < buckets.size(); ++i) {
+				buckets[i] += other.buckets[i];
+			}
+			count += other.count;
+			sum += other.sum;
+			min = std::min(min, other.min);
+			max = std::max(max, other.max);
+		}
+
+		void reset()
+		{
+			std::fill(buckets.begin(), buckets.end(), 0);
+			count = 0;
+			sum = 0;
+			min = std::numeric_limits<std::uint64_t>::max();
+			max = 0;
+		}
+
+		// the largest value that falls into the same bucket as the sample of the given rank
+		std::uint64_t percentile(double percent) const
+		{
+			if (count == 0) {
+				return 0;
+			}
+			std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(percent / 100 * count));
+			rank = std::min(std::max<std::uint64_t>(rank, 1), count);
+			std::uint64_t seen = 0;
+			for (size_type i = 0; i < buckets.size(); ++i) {
+				seen += buckets[i];
+				if (seen >= rank) {
+					return std::min(highestInBucket(i), max);
+				}
+			}
+			return max;
+		}
+
+		std::uint64_t getCount() const
+		{
+			return count;
+		}
+
+		std::uint64_t getMin() const
+		{
+			return count != 0 ? min : 0;
+		}
+
+		std::uint64_t getMax() const
+		{
+			return max;
+		}
+
+		double getMean() const
+		{
+			return count != 0 ? static_cast<double>(sum) / count : 0;
+		}
+
+	private:
+		unsigned precision_bits;
+		size_type half;
+		std::vector<std::uint64_t> buckets;
+		std::uint64_t count;
+		std::uint64_t sum;
+		std::uint64_t min;
+		std::uint64_t max;
+
+		// called from the initializer list, so that half is never computed from a bad value
+		static unsigned checkPrecision(unsigned precision_bits)
+		{
+			if (precision_bits < 1 || precision_bits > 16) {
+				throw std::invalid_argument("histogram precision must be between 1 and 16 bits");
+			}
+			return precision_bits;
+		}
+
+		static unsigned highestBit(std::uint64_t value)
+		{
+			return 63 - __builtin_clzll(value);
+		}
+
+		// values below 2 * half map to themselves; above that, shift drops all but the top
+		// precision_bits bits and every shift step adds another half of buckets
+		size_type index(std::uint64_t value) const
+		{
+			unsigned shift = value < 2 * half ? 0 : highestBit(value) - precision_bits + 1;
+			return shift * half + static_cast<size_type>(value >> shift);
+		}
+
+		std::uint64_t highestInBucket(size_type bucket) const
+		{
+			if (bucket < 2 * half) {
+				return bucket;
+			}
+			unsigned shift = static_cast<unsigned>((bucket - 2 * half) / half + 1);
+			std::uint64_t mantissa = bucket - shift * half;
+			return (mantissa << shift) + ((std::uint64_t(1) << shift) - 1);
+		}
+	};
+
+	// A cheap timestamp for timing single operations: the TSC on x86, which is assumed to be
+	// invariant, and steady_clock elsewhere. It is calibrated once against steady_clock, and the cost
+	// of taking two timestamps is subtracted from every interval.
+	class LatencyClock {
+	public:
+		using ticks = std::uint64_t;
+
+		static const LatencyClock& instance()
+		{
+			static const LatencyClock clock;
+			return clock;
+		}
+
+		static ticks now()
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			_mm_lfence();
+			ticks result = __rdtsc();
+			_mm_lfence();
+			return result;
+#else
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+		}
+
+		std::uint64_t toNanoseconds(ticks begin, ticks end) const
+		{
+			ticks elapsed = end - begin;
+			elapsed = elapsed > overhead ? elapsed - overhead : 0;
+			return static_cast<std::uint64_t>(elapsed * nanoseconds_per_tick + 0.5);
+		}
+
+		double getNanosecondsPerTick() const
+		{
+			return nanoseconds_per_tick;
+		}
+
+		ticks getOverhead() const
+		{
+			return overhead;
+		}
+
+	private:
+		double nanoseconds_per_tick;
+		ticks overhead;
+
+		LatencyClock()
+			: nanoseconds_per_tick(1)
+			, overhead(std::numeric_limits<ticks>::max())
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			using clock = std::chrono::steady_clock;
+			clock::time_point wall_begin = clock::now();
+			ticks begin = now();
+			while (clock::now() - wall_begin < std::chrono::milliseconds(10)) {
+			}
+			ticks end = now();
+			clock::time_point wall_end = clock::now();
+			nanoseconds_per_tick = std::chrono::duration<double, std::nano>(wall_end - wall_begin).count() / (end - begin);
+#endif
+			// the cheapest of many back-to-back pairs is the cost of timing nothing
+			for (int i = 0; i < 1000; ++i) {
+				ticks begin = now();
+				ticks end = now();
+				overhead = std::min(overhead, end - begin);
+			}
+		}
+	};
+
+}
+
+#endif /* AISDI_LATENCYHISTOGRAM_H */
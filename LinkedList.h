@@ -2,8 +2,11 @@
 #define AISDI_LINEAR_LINKEDLIST_H
 
 #include <cstddef>
+#include <functional>
 #include <initializer_list>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 namespace aisdi
 {
@@ -44,9 +47,7 @@ namespace aisdi
 			, tail(nullptr)
 			, size(0)
 		{
-			for (const auto& it : other) {
-				append(it);
-			}
+			appendCopies(other.root);
 		}
 
 		LinkedList(LinkedList&& other)
@@ -67,10 +68,7 @@ namespace aisdi
 		LinkedList& operator=(const LinkedList& other)
 		{
 			if (this != &other) {
-				clear();
-				for (const auto& it : other) {
-					append(it);
-				}
+				assign(other, std::is_copy_assignable<Type>());
 			}
 			return *this;
 		}
@@ -111,29 +109,112 @@ namespace aisdi
 
 		void insert(const const_iterator& insertPosition, const Type& item)
 		{
-			Node* to_add = new Node(item);
+			linkBefore(insertPosition.ptr, new Node(item));
+		}
 
-			if (isEmpty()) {
-				root = to_add;
-				tail = to_add;
+		// moves the element at it from other to before position by relinking its node;
+		// iterators to the element stay valid but still report other as their list
+		void splice(const const_iterator& position, LinkedList& other, const const_iterator& it)
+		{
+			if (it.ptr == nullptr) {
+				throw std::out_of_range("splicing end() iterator");
 			}
-			else if (insertPosition.ptr == root) {
-				to_add->next = root;
-				root->prev = to_add;
-				root = to_add;
+			if (position.ptr == it.ptr) {
+				return;
 			}
-			else if (insertPosition.ptr == nullptr) {
-				to_add->prev = tail;
-				tail->next = to_add;
-				tail = to_add;
+			other.unlink(it.ptr);
+			linkBefore(position.ptr, it.ptr);
+		}
+
+		// moves every element of other to before position without copying; other is left empty
+		void splice(const const_iterator& position, LinkedList& other)
+		{
+			if (this == &other || other.isEmpty()) {
+				return;
 			}
-			else {
-				to_add->next = insertPosition.ptr;
-				to_add->prev = insertPosition.ptr->prev;
-				insertPosition.ptr->prev->next = to_add;
-				insertPosition.ptr->prev = to_add;
+			linkRangeBefore(position.ptr, other.root, other.tail, other.size);
+			other.root = nullptr;
+			other.tail = nullptr;
+			other.size = 0;
+		}
+
+		// moves [first, last) of other to before position; linear only in the length of the range,
+		// which has to be counted when it comes from another list
+		void splice(const const_iterator& position, LinkedList& other, const const_iterator& first,
+			const const_iterator& last)
+		{
+			if (first == last) {
+				return;
 			}
-			++size;
+			Node* back = last.ptr != nullptr ? last.ptr->prev : other.tail;
+			size_type count = 0;
+			if (this != &other) {
+				for (Node* node = first.ptr; node != last.ptr; node = node->next) {
+					if (node == nullptr) {
+						throw std::out_of_range("splicing past end() iterator");
+					}
+					++count;
+				}
+			}
+			else if (position == first || position == last) {
+				return;
+			}
+			other.unlinkRange(first.ptr, back, count);
+			linkRangeBefore(position.ptr, first.ptr, back, count);
+		}
+
+		void appendAll(LinkedList&& other)
+		{
+			splice(cend(), other);
+		}
+
+		// stable merge sort that relinks the nodes; elements are never copied or moved
+		template <typename Compare = std::less<Type>>
+		void sort(Compare comp = Compare())
+		{
+			if (size < 2) {
+				return;
+			}
+			// bins[i] holds a sorted run of 2^i nodes, combined like carries of a binary counter, so
+			// the merges mostly touch nodes that were visited recently
+			Node* bins[64] = {};
+			size_type used = 0;
+			Node* chain = root;
+			while (chain != nullptr) {
+				Node* run = chain;
+				chain = chain->next;
+				run->next = nullptr;
+				size_type i = 0;
+				for (; i < used && bins[i] != nullptr; ++i) {
+					run = mergeChains(bins[i], run, comp);
+					bins[i] = nullptr;
+				}
+				if (i == used) {
+					++used;
+				}
+				bins[i] = run;
+			}
+			// higher bins hold earlier elements, so they go on the left to keep the sort stable
+			chain = nullptr;
+			for (size_type i = 0; i < used; ++i) {
+				chain = mergeChains(bins[i], chain, comp);
+			}
+			relinkChain(chain);
+		}
+
+		// merges the sorted other into this sorted list by relinking; on ties elements of this
+		// list come first, and other is left empty
+		template <typename Compare = std::less<Type>>
+		void merge(LinkedList& other, Compare comp = Compare())
+		{
+			if (this == &other || other.isEmpty()) {
+				return;
+			}
+			size += other.size;
+			relinkChain(mergeChains(root, other.root, comp));
+			other.root = nullptr;
+			other.tail = nullptr;
+			other.size = 0;
 		}
 
 		Type popFirst()
@@ -164,34 +245,29 @@ namespace aisdi
 			if (possition.ptr == nullptr) {
 				throw std::out_of_range("erasing end() iterator");
 			}
-			if (root == tail) {
-				root = nullptr;
-				tail = nullptr;
-			}
-			else if (possition.ptr == root) {
-				root = root->next;
-				root->prev = nullptr;
-			}
-			else if (possition.ptr == tail) {
-				tail = tail->prev;
-				tail->next = nullptr;
-			}
-			else {
-				possition.ptr->prev->next = possition.ptr->next;
-				possition.ptr->next->prev = possition.ptr->prev;
-			}
+			unlink(possition.ptr);
 			delete possition.ptr;
-			--size;
 		}
 
+		// detaches the whole range with a single relink before freeing it
 		void erase(const const_iterator& firstIncluded, const const_iterator& lastExcluded)
 		{
-			Node* to_delete = firstIncluded.ptr;
-			Node* temp = to_delete;
-			while (temp != lastExcluded.ptr) {
-				to_delete = temp;
-				temp = temp->next;
-				erase(iterator(*this, to_delete));
+			if (firstIncluded == lastExcluded) {
+				return;
+			}
+			size_type count = 0;
+			for (Node* node = firstIncluded.ptr; node != lastExcluded.ptr; node = node->next) {
+				if (node == nullptr) {
+					throw std::out_of_range("erasing past end() iterator");
+				}
+				++count;
+			}
+			Node* back = lastExcluded.ptr != nullptr ? lastExcluded.ptr->prev : tail;
+			unlinkRange(firstIncluded.ptr, back, count);
+			for (Node* node = firstIncluded.ptr; node != nullptr;) {
+				Node* next = node->next;
+				delete node;
+				node = next;
 			}
 		}
 
@@ -232,6 +308,147 @@ namespace aisdi
 		Node* tail;
 		size_type size;
 
+		void linkBefore(Node* position, Node* node)
+		{
+			node->next = position;
+			node->prev = position != nullptr ? position->prev : tail;
+			if (node->prev != nullptr) {
+				node->prev->next = node;
+			}
+			else {
+				root = node;
+			}
+			if (position != nullptr) {
+				position->prev = node;
+			}
+			else {
+				tail = node;
+			}
+			++size;
+		}
+
+		void unlink(Node* node)
+		{
+			if (node->prev != nullptr) {
+				node->prev->next = node->next;
+			}
+			else {
+				root = node->next;
+			}
+			if (node->next != nullptr) {
+				node->next->prev = node->prev;
+			}
+			else {
+				tail = node->prev;
+			}
+			node->next = nullptr;
+			node->prev = nullptr;
+			--size;
+		}
+
+		// links the chain front..back of count nodes before position
+		void linkRangeBefore(Node* position, Node* front, Node* back, size_type count)
+		{
+			front->prev = position != nullptr ? position->prev : tail;
+			back->next = position;
+			if (front->prev != nullptr) {
+				front->prev->next = front;
+			}
+			else {
+				root = front;
+			}
+			if (position != nullptr) {
+				position->prev = back;
+			}
+			else {
+				tail = back;
+			}
+			size += count;
+		}
+
+		// detaches front..back, leaving it a chain terminated by nullptr at both ends
+		void unlinkRange(Node* front, Node* back, size_type count)
+		{
+			if (front->prev != nullptr) {
+				front->prev->next = back->next;
+			}
+			else {
+				root = back->next;
+			}
+			if (back->next != nullptr) {
+				back->next->prev = front->prev;
+			}
+			else {
+				tail = front->prev;
+			}
+			front->prev = nullptr;
+			back->next = nullptr;
+			size -= count;
+		}
+
+		void appendCopies(const Node* source)
+		{
+			for (; source != nullptr; source = source->next) {
+				linkBefore(nullptr, new Node(source->data));
+			}
+		}
+
+		// reuses the nodes already allocated and only allocates or frees the difference; if copying
+		// an element throws, the list stays valid but holds a mix of old and new elements
+		void assign(const LinkedList& other, std::true_type)
+		{
+			Node* source = other.root;
+			Node* target = root;
+			for (; source != nullptr && target != nullptr; source = source->next, target = target->next) {
+				target->data = source->data;
+			}
+			if (target != nullptr) {
+				erase(const_iterator(*this, target), cend());
+			}
+			appendCopies(source);
+		}
+
+		// elements that cannot be assigned, e.g. pairs with a const key, get a fresh chain
+		void assign(const LinkedList& other, std::false_type)
+		{
+			LinkedList copy(other);
+			*this = std::move(copy);
+		}
+
+		// merges two sorted chains linked by next only, preferring left on ties
+		template <typename Compare>
+		static Node* mergeChains(Node* left, Node* right, Compare& comp)
+		{
+			Node* result = nullptr;
+			Node** result_tail = &result;
+			while (left != nullptr && right != nullptr) {
+				if (comp(right->data, left->data)) {
+					*result_tail = right;
+					result_tail = &right->next;
+					right = right->next;
+				}
+				else {
+					*result_tail = left;
+					result_tail = &left->next;
+					left = left->next;
+				}
+			}
+			*result_tail = left != nullptr ? left : right;
+			return result;
+		}
+
+		// restores prev pointers and tail after the chain was rebuilt through next
+		void relinkChain(Node* chain)
+		{
+			root = chain;
+			Node* prev = nullptr;
+			for (Node* node = chain; node != nullptr; node = node->next) {
+				node->prev = prev;
+				prev = node;
+			}
+			tail = prev;
+		}
+
 		void clear()
 		{
 			size = 0;
@@ -276,8 +493,13 @@ namespace aisdi
 
 		friend class LinkedList<Type>;
 
+		ConstIterator()
+			: parent(nullptr)
+			, ptr(nullptr)
+		{}
+
 		explicit ConstIterator(const LinkedList& list, Node* node)
-			: parent(list)
+			: parent(&list)
 			, ptr(node)
 		{}
 
@@ -307,11 +529,11 @@ namespace aisdi
 
 		ConstIterator& operator--()
 		{
-			if (ptr == parent.root) {
+			if (ptr == parent->root) {
 				throw std::out_of_range("decrementing begin() iterator");
 			}
 			if (ptr == nullptr) {
-				ptr = parent.tail;
+				ptr = parent->tail;
 			}
 			else {
 				ptr = ptr->prev;
@@ -343,11 +565,11 @@ namespace aisdi
 		{
 			ConstIterator temp = *this;
 			while (d) {
-				if (temp.ptr == parent.root) {
+				if (temp.ptr == parent->root) {
 					throw std::out_of_range("decrementing begin() iterator");
 				}
 				if (temp.ptr == nullptr) {
-					temp.ptr = parent.tail;
+					temp.ptr = parent->tail;
 				}
 				else {
 					temp.ptr = temp.ptr->prev;
@@ -373,7 +595,7 @@ namespace aisdi
 		}
 
 	protected:
-		const LinkedList<Type>& parent;
+		const LinkedList<Type>* parent;
 		Node* ptr;
 	};
 
@@ -383,6 +605,10 @@ namespace aisdi
 		using pointer = typename LinkedList::pointer;
 		using reference = typename LinkedList::reference;
 
+		Iterator()
+			: ConstIterator()
+		{}
+
 		explicit Iterator(const LinkedList& parent, Node* node)
 			: ConstIterator(parent, node)
 		{}
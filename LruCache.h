@@ -0,0 +1,181 @@
+#ifndef AISDI_MAPS_LRUCACHE_H
+#define AISDI_MAPS_LRUCACHE_H
+
+#include "HashMap.h"
+#include "LinkedList.h"
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+namespace aisdi
+{
+
+	// Least-recently-used cache: a HashMap from key to the entry's node in a recency LinkedList
+	// (most recent first). Lookups, promotion and eviction relink nodes and never walk the list.
+	template <typename KeyType, typename ValueType>
+	class LruCache {
+	public:
+		using key_type = KeyType;
+		using mapped_type = ValueType;
+		using size_type = std::size_t;
+		using EvictionCallback = std::function<void(const key_type&, const mapped_type&)>;
+		using SizeFunction = std::function<size_type(const key_type&, const mapped_type&)>;
+
+		explicit LruCache(size_type max_entries)
+			: LruCache(max_entries, 0, nullptr)
+		{}
+
+		// max_bytes of 0 disables the byte budget; entry_size reports the cost of an entry in bytes
+		LruCache(size_type max_entries, size_type max_bytes, SizeFunction entry_size)
+			: max_entries(max_entries)
+			, max_bytes(max_bytes)
+			, bytes(0)
+			, hits(0)
+			, misses(0)
+			, evictions(0)
+			, entry_size(std::move(entry_size))
+		{
+			if (max_entries == 0) {
+				throw std::invalid_argument("cache capacity must be positive");
+			}
+		}
+
+		// index holds iterators into recency, which a copy would still share with the original;
+		// moving keeps the nodes, so those stay valid
+		LruCache(const LruCache&) = delete;
+		LruCache& operator=(const LruCache&) = delete;
+		LruCache(LruCache&&) = default;
+		LruCache& operator=(LruCache&&) = default;
+
+		void setEvictionCallback(EvictionCallback callback)
+		{
+			on_evict = std::move(callback);
+		}
+
+		bool isEmpty() const
+		{
+			return recency.isEmpty();
+		}
+
+		size_type getSize() const
+		{
+			return recency.getSize();
+		}
+
+		size_type getByteCount() const
+		{
+			return bytes;
+		}
+
+		// returns nullptr on a miss; a hit becomes the most recently used entry
+		mapped_type* get(const key_type& key)
+		{
+			auto search = index.find(key);
+			if (search == index.end()) {
+				++misses;
+				return nullptr;
+			}
+			++hits;
+			EntryIterator entry = search->second;
+			recency.splice(recency.begin(), recency, entry);
+			return &entry->value;
+		}
+
+		// does not promote the entry or touch the counters
+		bool contains(const key_type& key) const
+		{
+			return index.find(key) != index.end();
+		}
+
+		void put(const key_type& key, const mapped_type& value)
+		{
+			size_type cost = entry_size ? entry_size(key, value) : 0;
+			auto search = index.find(key);
+			if (search != index.end()) {
+				EntryIterator entry = search->second;
+				bytes = bytes - entry->bytes + cost;
+				entry->value = value;
+				entry->bytes = cost;
+				recency.splice(recency.begin(), recency, entry);
+			}
+			else {
+				recency.prepend(Entry{ key, value, cost });
+				index[key] = recency.begin();
+				bytes += cost;
+			}
+
+			while (!recency.isEmpty() && (recency.getSize() > max_entries || (max_bytes != 0 && bytes > max_bytes))) {
+				evict();
+			}
+		}
+
+		void remove(const key_type& key)
+		{
+			auto search = index.find(key);
+			if (search == index.end()) {
+				throw std::out_of_range("cannot remove element with non-existent key");
+			}
+			EntryIterator entry = search->second;
+			bytes -= entry->bytes;
+			index.remove(search);
+			recency.erase(entry);
+		}
+
+		size_type getHits() const
+		{
+			return hits;
+		}
+
+		size_type getMisses() const
+		{
+			return misses;
+		}
+
+		size_type getEvictions() const
+		{
+			return evictions;
+		}
+
+		void resetCounters()
+		{
+			hits = 0;
+			misses = 0;
+			evictions = 0;
+		}
+
+	private:
+		struct Entry {
+			key_type key;
+			mapped_type value;
+			size_type bytes;
+		};
+
+		using EntryIterator = typename LinkedList<Entry>::iterator;
+
+		LinkedList<Entry> recency;
+		HashMap<key_type, EntryIterator> index;
+		size_type max_entries;
+		size_type max_bytes;
+		size_type bytes;
+		size_type hits;
+		size_type misses;
+		size_type evictions;
+		SizeFunction entry_size;
+		EvictionCallback on_evict;
+
+		void evict()
+		{
+			Entry victim = recency.popLast();
+			index.remove(victim.key);
+			bytes -= victim.bytes;
+			++evictions;
+			if (on_evict) {
+				on_evict(victim.key, victim.value);
+			}
+		}
+	};
+
+}
+
+#endif /* AISDI_MAPS_LRUCACHE_H */
@@ -0,0 +1,768 @@
+#ifndef AISDI_MAPS_LSMSTORE_H
+#define AISDI_MAPS_LSMSTORE_H
+
+#include "BloomFilter.h"
+#include "TreeMap.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace aisdi
+{
+
+	// Byte encoding of keys and values in LsmStore files. Arithmetic types are stored raw in host
+	// byte order, so files are not portable between architectures; other types need a specialization.
+	template <typename Type, typename Enable = void>
+	struct LsmCodec;
+
+	template <typename Type>
+	struct LsmCodec<Type, typename std::enable_if<std::is_arithmetic<Type>::value>::type> {
+		static void encode(std::string& out, const Type& value)
+		{
+			out.append(reinterpret_cast<const char*>(&value), sizeof(Type));
+		}
+
+		static bool decode(std::istream& in, Type& value)
+		{
+			return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(Type)));
+		}
+	};
+
+	template <>
+	struct LsmCodec<std::string> {
+		static void encode(std::string& out, const std::string& value)
+		{
+			std::uint32_t length = static_cast<std::uint32_t>(value.size());
+			out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+			out.append(value);
+		}
+
+		static bool decode(std::istream& in, std::string& value)
+		{
+			std::uint32_t length;
+			if (!in.read(reinterpret_cast<char*>(&length), sizeof(length))) {
+				return false;
+			}
+			value.resize(length);
+			return length == 0 || static_cast<bool>(in.read(&value[0], length));
+		}
+	};
+
+	struct LsmOptions {
+		// entries buffered in memory before they are written out as a run
+		std::size_t memtable_limit = 1 << 16;
+		// number of runs that starts a background compaction
+		std::size_t compaction_trigger = 4;
+		// writes stall while this many runs wait for compaction
+		std::size_t stall_limit = 12;
+		// every index_interval-th record of a run is kept in its in-memory index
+		std::size_t index_interval = 16;
+		std::size_t bloom_bits_per_key = 10;
+	};
+
+	// Ordered key-value store that can outgrow memory. Writes go to a write-ahead log and a TreeMap
+	// memtable; a full memtable is written out as an immutable sorted run with a sparse index and a
+	// Bloom filter. A background thread merges the runs into one when enough of them pile up.
+	// Reads check the memtable first and then the runs from newest to oldest.
+	//
+	// Files live next to each other under a common path prefix: <path>.manifest lists the live runs,
+	// <path>.wal holds writes not yet in a run and <path>.run.<n> are the runs. The log is flushed to
+	// the operating system after every write but not synced to the device. A store object is meant
+	// to be used from one thread at a time.
+	template <typename KeyType, typename ValueType, typename Compare = std::less<KeyType>>
+	class LsmStore {
+	public:
+		using key_type = KeyType;
+		using mapped_type = ValueType;
+		using value_type = std::pair<const key_type, mapped_type>;
+		using size_type = std::size_t;
+		using key_compare = Compare;
+
+		// opens the store at path, creating it if needed and replaying the log of an earlier session
+		explicit LsmStore(const std::string& path, const LsmOptions& options = LsmOptions(), const Compare& comp = Compare())
+			: path(path)
+			, options(options)
+			, comp(comp)
+			, memtable(comp)
+			, next_file(0)
+			, stopping(false)
+			, compacting(false)
+		{
+			if (options.memtable_limit == 0 || options.index_interval == 0 || options.compaction_trigger < 2) {
+				throw std::invalid_argument("invalid LSM store options");
+			}
+			// time-ordered keys would otherwise turn the unbalanced memtable into a list
+			memtable.setAccessPolicy(TreeAccessPolicy::Splay);
+			loadManifest();
+			replayLog();
+			wal.open(walFile(), std::ios::binary | std::ios::app);
+			if (!wal) {
+				throw std::runtime_error("cannot open write-ahead log " + walFile());
+			}
+			compactor = std::thread([this]() { compactionLoop(); });
+			if (memtable.getSize() >= options.memtable_limit) {
+				flush();
+			}
+		}
+
+		LsmStore(const LsmStore&) = delete;
+		LsmStore& operator=(const LsmStore&) = delete;
+
+		// an unfinished compaction is abandoned; buffered writes stay in the log
+		~LsmStore()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			wakeup.notify_all();
+			compactor.join();
+		}
+
+		void put(const key_type& key, const mapped_type& value)
+		{
+			write(key, Entry{ value, false });
+		}
+
+		// records a deletion; removing a key that is not there is not an error
+		void remove(const key_type& key)
+		{
+			write(key, Entry{ mapped_type(), true });
+		}
+
+		bool tryGet(const key_type& key, mapped_type& value) const
+		{
+			auto search = memtable.find(key);
+			if (search != memtable.end()) {
+				if (search->second.deleted) {
+					return false;
+				}
+				value = search->second.value;
+				return true;
+			}
+
+			Entry entry;
+			for (const auto& run : currentRuns()) {
+				if (run->get(key, entry, comp)) {
+					if (entry.deleted) {
+						return false;
+					}
+					value = std::move(entry.value);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		mapped_type valueOf(const key_type& key) const
+		{
+			mapped_type value;
+			if (!tryGet(key, value)) {
+				throw std::out_of_range("cannot access non-existent element");
+			}
+			return value;
+		}
+
+		bool contains(const key_type& key) const
+		{
+			mapped_type value;
+			return tryGet(key, value);
+		}
+
+		// calls fn(key, value) in key order for every live key in [from, to)
+		template <typename Function>
+		void forEachInRange(const key_type& from, const key_type& to, Function fn) const
+		{
+			std::vector<Cursor> cursors;
+			std::vector<std::pair<key_type, Entry>> buffered;
+			for (auto it = memtable.lowerBound(from); it != memtable.end() && comp(it->first, to); ++it) {
+				buffered.emplace_back(it->first, it->second);
+			}
+			cursors.emplace_back(buffered);
+			for (const auto& run : currentRuns()) {
+				cursors.emplace_back(*run, run->seekOffset(from, comp));
+			}
+			for (auto& cursor : cursors) {
+				while (cursor.valid && comp(cursor.key, from)) {
+					cursor.next();
+				}
+			}
+
+			key_type key;
+			Entry entry;
+			while (mergeNext(cursors, key, entry) && comp(key, to)) {
+				if (!entry.deleted) {
+					fn(static_cast<const key_type&>(key), static_cast<const mapped_type&>(entry.value));
+				}
+			}
+		}
+
+		// writes the memtable out as a run even if it is not full
+		void flush()
+		{
+			rethrowCompactionError();
+			if (memtable.isEmpty()) {
+				return;
+			}
+
+			std::unique_lock<std::mutex> lock(mutex);
+			stalled.wait(lock, [this]() { return runs.size() < options.stall_limit || error || stopping; });
+			size_type number = next_file++;
+			lock.unlock();
+
+			RunWriter writer(runFile(number), memtable.getSize(), options);
+			for (auto it = memtable.begin(); it != memtable.end(); ++it) {
+				writer.add(it->first, it->second);
+			}
+			std::shared_ptr<Run> run = writer.finish(number);
+
+			lock.lock();
+			runs.insert(runs.begin(), run);
+			writeManifest();
+			lock.unlock();
+
+			wal.close();
+			wal.open(walFile(), std::ios::binary | std::ios::trunc);
+			memtable.clear();
+			wakeup.notify_all();
+		}
+
+		// blocks until no compaction is running or due
+		void waitForCompaction()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			stalled.wait(lock, [this]() { return (!compacting && runs.size() < options.compaction_trigger) || error || stopping; });
+			lock.unlock();
+			rethrowCompactionError();
+		}
+
+		size_type getRunCount() const
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return runs.size();
+		}
+
+		size_type getMemtableSize() const
+		{
+			return memtable.getSize();
+		}
+
+		// deletes every file of the store at path; the store must not be open
+		static void destroy(const std::string& path)
+		{
+			std::ifstream manifest(path + ".manifest");
+			std::string word;
+			size_type number;
+			if (manifest >> word >> number) {
+				while (manifest >> number) {
+					std::remove((path + ".run." + std::to_string(number)).c_str());
+				}
+			}
+			manifest.close();
+			std::remove((path + ".manifest").c_str());
+			std::remove((path + ".wal").c_str());
+		}
+
+	private:
+		struct Entry {
+			mapped_type value;
+			bool deleted = false;
+		};
+
+		// Bloom filters are stored in the runs, so they hash the encoded key rather than rely on std::hash
+		struct KeyHash {
+			std::size_t operator()(const key_type& key) const
+			{
+				std::string bytes;
+				LsmCodec<key_type>::encode(bytes, key);
+				std::uint64_t hash = 0xCBF29CE484222325ull;
+				for (unsigned char byte : bytes) {
+					hash = (hash ^ byte) * 0x100000001B3ull;
+				}
+				return static_cast<std::size_t>(hash);
+			}
+		};
+
+		using Filter = BloomFilter<key_type, KeyHash>;
+
+		static const std::uint64_t RUN_MAGIC = 0x314E55524D534C41ull;
+
+		static void encodeRecord(std::string& out, const key_type& key, const Entry& entry)
+		{
+			out.push_back(entry.deleted ? 1 : 0);
+			LsmCodec<key_type>::encode(out, key);
+			if (!entry.deleted) {
+				LsmCodec<mapped_type>::encode(out, entry.value);
+			}
+		}
+
+		static bool decodeRecord(std::istream& in, key_type& key, Entry& entry)
+		{
+			char flag;
+			if (!in.get(flag) || !LsmCodec<key_type>::decode(in, key)) {
+				return false;
+			}
+			entry.deleted = flag != 0;
+			if (entry.deleted) {
+				entry.value = mapped_type();
+				return true;
+			}
+			return LsmCodec<mapped_type>::decode(in, entry.value);
+		}
+
+		template <typename Integer>
+		static void writeInteger(std::ostream& out, Integer value)
+		{
+			out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+		}
+
+		template <typename Integer>
+		static Integer readInteger(std::istream& in)
+		{
+			Integer value;
+			if (!in.read(reinterpret_cast<char*>(&value), sizeof(value))) {
+				throw std::runtime_error("truncated LSM run file");
+			}
+			return value;
+		}
+
+		// An immutable sorted file: records, then the sparse index, the Bloom filter and a fixed footer.
+		class Run {
+		public:
+			Run(const std::string& file, std::size_t number)
+				: file(file)
+				, number(number)
+				, obsolete(false)
+				, in(file, std::ios::binary)
+				, filter(std::vector<std::uint64_t>(1, 0), 1)
+			{
+				if (!in) {
+					throw std::runtime_error("cannot open LSM run " + file);
+				}
+				in.seekg(-static_cast<std::streamoff>(4 * sizeof(std::uint64_t)), std::ios::end);
+				std::uint64_t index_offset = readInteger<std::uint64_t>(in);
+				std::uint64_t filter_offset = readInteger<std::uint64_t>(in);
+				entry_count = readInteger<std::uint64_t>(in);
+				if (readInteger<std::uint64_t>(in) != RUN_MAGIC) {
+					throw std::runtime_error("corrupt LSM run " + file);
+				}
+				data_end = index_offset;
+
+				in.seekg(static_cast<std::streamoff>(index_offset));
+				std::uint64_t index_size = readInteger<std::uint64_t>(in);
+				index.reserve(index_size);
+				for (std::uint64_t i = 0; i < index_size; ++i) {
+					key_type key;
+					if (!LsmCodec<key_type>::decode(in, key)) {
+						throw std::runtime_error("corrupt LSM run " + file);
+					}
+					index.emplace_back(std::move(key), readInteger<std::uint64_t>(in));
+				}
+
+				in.seekg(static_cast<std::streamoff>(filter_offset));
+				std::uint64_t hash_count = readInteger<std::uint64_t>(in);
+				std::vector<std::uint64_t> words(readInteger<std::uint64_t>(in));
+				for (auto& word : words) {
+					word = readInteger<std::uint64_t>(in);
+				}
+				filter = Filter(std::move(words), hash_count);
+			}
+
+			Run(const Run&) = delete;
+			Run& operator=(const Run&) = delete;
+
+			// the file goes away with the last reader of a run that compaction has replaced
+			~Run()
+			{
+				in.close();
+				if (obsolete) {
+					std::remove(file.c_str());
+				}
+			}
+
+			// offset of the index block that may hold key: the last one starting at or before it
+			std::uint64_t seekOffset(const key_type& key, const Compare& comp) const
+			{
+				auto block = std::upper_bound(index.begin(), index.end(), key,
+					[&comp](const key_type& a, const std::pair<key_type, std::uint64_t>& b) { return comp(a, b.first); });
+				return block == index.begin() ? 0 : (block - 1)->second;
+			}
+
+			bool get(const key_type& key, Entry& entry, const Compare& comp)
+			{
+				if (!filter.mayContain(key) || index.empty() || comp(key, index.front().first)) {
+					return false;
+				}
+
+				in.clear();
+				in.seekg(static_cast<std::streamoff>(seekOffset(key, comp)));
+				key_type current;
+				while (static_cast<std::uint64_t>(in.tellg()) < data_end && decodeRecord(in, current, entry)) {
+					if (comp(key, current)) {
+						return false;
+					}
+					if (!comp(current, key)) {
+						return true;
+					}
+				}
+				return false;
+			}
+
+			const std::string file;
+			const std::size_t number;
+			std::atomic<bool> obsolete;
+			std::uint64_t entry_count;
+			std::uint64_t data_end;
+
+		private:
+			std::ifstream in;
+			std::vector<std::pair<key_type, std::uint64_t>> index;
+			Filter filter;
+		};
+
+		class RunWriter {
+		public:
+			RunWriter(const std::string& file, std::size_t expected_count, const LsmOptions& options)
+				: file(file)
+				, out(file, std::ios::binary | std::ios::trunc)
+				, filter(expected_count, options.bloom_bits_per_key)
+				, index_interval(options.index_interval)
+				, count(0)
+				, offset(0)
+			{
+				if (!out) {
+					throw std::runtime_error("cannot create LSM run " + file);
+				}
+			}
+
+			void add(const key_type& key, const Entry& entry)
+			{
+				if (count++ % index_interval == 0) {
+					index.emplace_back(key, offset);
+				}
+				filter.add(key);
+				record.clear();
+				encodeRecord(record, key, entry);
+				out.write(record.data(), record.size());
+				offset += record.size();
+			}
+
+			std::size_t getCount() const
+			{
+				return count;
+			}
+
+			std::shared_ptr<Run> finish(std::size_t number)
+			{
+				std::uint64_t index_offset = offset;
+				writeInteger<std::uint64_t>(out, index.size());
+				for (const auto& block : index) {
+					record.clear();
+					LsmCodec<key_type>::encode(record, block.first);
+					out.write(record.data(), record.size());
+					writeInteger<std::uint64_t>(out, block.second);
+				}
+				std::uint64_t filter_offset = static_cast<std::uint64_t>(out.tellp());
+				writeInteger<std::uint64_t>(out, filter.getHashCount());
+				writeInteger<std::uint64_t>(out, filter.getWords().size());
+				for (std::uint64_t word : filter.getWords()) {
+					writeInteger<std::uint64_t>(out, word);
+				}
+				writeInteger<std::uint64_t>(out, index_offset);
+				writeInteger<std::uint64_t>(out, filter_offset);
+				writeInteger<std::uint64_t>(out, count);
+				writeInteger<std::uint64_t>(out, RUN_MAGIC);
+				out.close();
+				if (!out) {
+					throw std::runtime_error("cannot write LSM run " + file);
+				}
+				return std::make_shared<Run>(file, number);
+			}
+
+		private:
+			std::string file;
+			std::ofstream out;
+			Filter filter;
+			std::vector<std::pair<key_type, std::uint64_t>> index;
+			std::string record;
+			std::size_t index_interval;
+			std::size_t count;
+			std::uint64_t offset;
+		};
+
+		// walks one source of a merge: a run read from its own stream, or a buffered memtable range
+		struct Cursor {
+			Cursor(const Run& run, std::uint64_t offset)
+				: in(new std::ifstream(run.file, std::ios::binary))
+				, end(run.data_end)
+				, items(nullptr)
+				, position(0)
+				, valid(true)
+			{
+				in->seekg(static_cast<std::streamoff>(offset));
+				next();
+			}
+
+			explicit Cursor(const std::vector<std::pair<key_type, Entry>>& items)
+				: end(0)
+				, items(&items)
+				, position(0)
+				, valid(true)
+			{
+				next();
+			}
+
+			void next()
+			{
+				if (items != nullptr) {
+					valid = position < items->size();
+					if (valid) {
+						key = (*items)[position].first;
+						entry = (*items)[position].second;
+						++position;
+					}
+					return;
+				}
+				valid = static_cast<std::uint64_t>(in->tellg()) < end && decodeRecord(*in, key, entry);
+			}
+
+			std::unique_ptr<std::ifstream> in;
+			std::uint64_t end;
+			const std::vector<std::pair<key_type, Entry>>* items;
+			std::size_t position;
+			bool valid;
+			key_type key;
+			Entry entry;
+		};
+
+		std::string path;
+		LsmOptions options;
+		Compare comp;
+		TreeMap<key_type, Entry, Compare> memtable;
+		std::ofstream wal;
+		std::string record;
+
+		// guards runs, next_file and the manifest, which the compaction thread also updates
+		mutable std::mutex mutex;
+		std::condition_variable wakeup;
+		std::condition_variable stalled;
+		// newest first
+		std::vector<std::shared_ptr<Run>> runs;
+		std::size_t next_file;
+		bool stopping;
+		bool compacting;
+		std::exception_ptr error;
+		std::thread compactor;
+
+		std::string walFile() const
+		{
+			return path + ".wal";
+		}
+
+		std::string manifestFile() const
+		{
+			return path + ".manifest";
+		}
+
+		std::string runFile(std::size_t number) const
+		{
+			return path + ".run." + std::to_string(number);
+		}
+
+		std::vector<std::shared_ptr<Run>> currentRuns() const
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return runs;
+		}
+
+		void rethrowCompactionError()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (error) {
+				std::rethrow_exception(error);
+			}
+		}
+
+		void write(const key_type& key, const Entry& entry)
+		{
+			record.clear();
+			encodeRecord(record, key, entry);
+			if (!wal.write(record.data(), record.size()).flush()) {
+				throw std::runtime_error("cannot append to write-ahead log " + walFile());
+			}
+			memtable[key] = entry;
+			if (memtable.getSize() >= options.memtable_limit) {
+				flush();
+			}
+		}
+
+		// the caller holds mutex; the new manifest replaces the old one in a single rename
+		void writeManifest()
+		{
+			std::string temporary = manifestFile() + ".tmp";
+			{
+				std::ofstream out(temporary, std::ios::trunc);
+				out << "next " << next_file << "\n";
+				for (const auto& run : runs) {
+					out << run->number << "\n";
+				}
+				if (!out.flush()) {
+					throw std::runtime_error("cannot write manifest " + temporary);
+				}
+			}
+			if (std::rename(temporary.c_str(), manifestFile().c_str()) != 0) {
+				std::remove(manifestFile().c_str());
+				if (std::rename(temporary.c_str(), manifestFile().c_str()) != 0) {
+					throw std::runtime_error("cannot replace manifest " + manifestFile());
+				}
+			}
+		}
+
+		void loadManifest()
+		{
+			std::ifstream in(manifestFile());
+			std::string word;
+			if (!(in >> word >> next_file)) {
+				next_file = 0;
+				return;
+			}
+			std::size_t number;
+			while (in >> number) {
+				runs.push_back(std::make_shared<Run>(runFile(number), number));
+			}
+		}
+
+		// a record cut short by a crash ends the replay
+		void replayLog()
+		{
+			std::ifstream in(walFile(), std::ios::binary);
+			key_type key;
+			Entry entry;
+			while (in && decodeRecord(in, key, entry)) {
+				memtable[key] = entry;
+			}
+		}
+
+		// the newest source holding the smallest key wins; every source at that key moves past it
+		bool mergeNext(std::vector<Cursor>& cursors, key_type& key, Entry& entry) const
+		{
+			Cursor* best = nullptr;
+			for (auto& cursor : cursors) {
+				if (cursor.valid && (best == nullptr || comp(cursor.key, best->key))) {
+					best = &cursor;
+				}
+			}
+			if (best == nullptr) {
+				return false;
+			}
+
+			key = best->key;
+			entry = best->entry;
+			for (auto& cursor : cursors) {
+				if (cursor.valid && !comp(key, cursor.key)) {
+					cursor.next();
+				}
+			}
+			return true;
+		}
+
+		void compactionLoop()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			for (;;) {
+				wakeup.wait(lock, [this]() { return stopping || runs.size() >= options.compaction_trigger; });
+				if (stopping) {
+					return;
+				}
+
+				std::vector<std::shared_ptr<Run>> inputs = runs;
+				std::size_t number = next_file++;
+				compacting = true;
+				lock.unlock();
+
+				std::shared_ptr<Run> merged;
+				bool finished = false;
+				try {
+					finished = compact(inputs, number, merged);
+				}
+				catch (...) {
+					lock.lock();
+					error = std::current_exception();
+					compacting = false;
+					stalled.notify_all();
+					return;
+				}
+
+				lock.lock();
+				compacting = false;
+				if (!finished) {
+					std::remove(runFile(number).c_str());
+					stalled.notify_all();
+					return;
+				}
+
+				// runs flushed meanwhile are newer than every input and stay in front
+				runs.resize(runs.size() - inputs.size());
+				if (merged) {
+					runs.push_back(merged);
+				}
+				writeManifest();
+				for (auto& input : inputs) {
+					input->obsolete = true;
+				}
+				stalled.notify_all();
+			}
+		}
+
+		// merges every run into one; the inputs include the oldest data, so deletions can be dropped
+		bool compact(const std::vector<std::shared_ptr<Run>>& inputs, std::size_t number, std::shared_ptr<Run>& merged)
+		{
+			std::vector<Cursor> cursors;
+			std::size_t expected = 0;
+			for (const auto& run : inputs) {
+				cursors.emplace_back(*run, 0);
+				expected += run->entry_count;
+			}
+
+			RunWriter writer(runFile(number), expected, options);
+			key_type key;
+			Entry entry;
+			for (std::size_t i = 0; mergeNext(cursors, key, entry); ++i) {
+				if (i % 4096 == 0) {
+					std::lock_guard<std::mutex> lock(mutex);
+					if (stopping) {
+						return false;
+					}
+				}
+				if (!entry.deleted) {
+					writer.add(key, entry);
+				}
+			}
+
+			if (writer.getCount() == 0) {
+				writer.finish(number).reset();
+				std::remove(runFile(number).c_str());
+				return true;
+			}
+			merged = writer.finish(number);
+			return true;
+		}
+	};
+
+}
+
+#endif /* AISDI_MAPS_LSMSTORE_H */
@@ -0,0 +1,115 @@
+#ifndef AISDI_MAPS_MAPSTATS_H
+#define AISDI_MAPS_MAPSTATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace aisdi
+{
+
+	// What a map did since it was created or since resetCounters(). Only counted when the program
+	// is compiled with AISDI_MAP_COUNTERS defined, otherwise all zero.
+	struct OperationCounts {
+		// key searches of any kind, including the ones inserts and removes start with
+		std::uint64_t lookups;
+		std::uint64_t inserts;
+		std::uint64_t removes;
+		// key comparisons made by those searches: equality tests in HashMap, Compare calls in TreeMap
+		std::uint64_t comparisons;
+	};
+
+	// Held by the maps; without AISDI_MAP_COUNTERS every call compiles to nothing. The counts are
+	// plain integers, so a map searched from several threads at once gets approximate ones.
+	class OperationCounters {
+	public:
+#if defined(AISDI_MAP_COUNTERS)
+		OperationCounters()
+			: counts()
+		{}
+
+		void lookup() const
+		{
+			++counts.lookups;
+		}
+
+		void insertion() const
+		{
+			++counts.inserts;
+		}
+
+		void removal() const
+		{
+			++counts.removes;
+		}
+
+		void comparison() const
+		{
+			++counts.comparisons;
+		}
+
+		OperationCounts get() const
+		{
+			return counts;
+		}
+
+		void reset()
+		{
+			counts = OperationCounts();
+		}
+
+	private:
+		mutable OperationCounts counts;
+#else
+		void lookup() const
+		{}
+
+		void insertion() const
+		{}
+
+		void removal() const
+		{}
+
+		void comparison() const
+		{}
+
+		OperationCounts get() const
+		{
+			return OperationCounts();
+		}
+
+		void reset()
+		{}
+#endif
+	};
+
+	struct HashMapStats {
+		std::size_t size;
+		// chains of the chained map, slots of the open-addressing one
+		std::size_t bucket_count;
+		// bucket_lengths[k] is the number of chains holding k entries; with open addressing, the
+		// number of runs of k consecutive non-empty slots, tombstones included
+		std::vector<std::size_t> bucket_lengths;
+		std::size_t max_chain;
+		double empty_bucket_ratio;
+		// keys compared on average when looking up a present key and a missing one
+		double average_probes_hit;
+		double average_probes_miss;
+		OperationCounts operations;
+	};
+
+	struct TreeMapStats {
+		std::size_t size;
+		// nodes on the longest path from the root, 0 for an empty tree
+		std::size_t height;
+		// edges from the root, averaged over all nodes
+		double average_depth;
+		// height of the right subtree minus height of the left one -> number of nodes
+		std::map<std::ptrdiff_t, std::size_t> balance_factors;
+		OperationCounts operations;
+	};
+
+}
+
+#endif /* AISDI_MAPS_MAPSTATS_H */
@@ -0,0 +1,192 @@
+#ifndef AISDI_MEMORYTRACKER_H
+#define AISDI_MEMORYTRACKER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace aisdi
+{
+
+	struct MemorySnapshot {
+		std::int64_t allocations;
+		std::int64_t frees;
+		std::int64_t live_bytes;
+		std::int64_t peak_bytes;
+	};
+
+	// Counts what goes through the global operator new and delete once enabled. Sizes are the
+	// allocator's usable sizes, i.e. what a block really occupies apart from malloc's own header,
+	// so nothing has to be stored next to the block; that needs glibc. The operators themselves
+	// are only replaced in the translation unit that defines AISDI_TRACK_ALLOCATIONS before
+	// including this header, which must be exactly one per program.
+	class MemoryTracker {
+	public:
+		static bool isSupported()
+		{
+#if defined(__GLIBC__)
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		static void setEnabled(bool enabled)
+		{
+			state().enabled.store(enabled && isSupported(), std::memory_order_relaxed);
+		}
+
+		static bool isEnabled()
+		{
+			return state().enabled.load(std::memory_order_relaxed);
+		}
+
+		static MemorySnapshot snapshot()
+		{
+			const State& counters = state();
+			return MemorySnapshot{ counters.allocations.load(std::memory_order_relaxed),
+				counters.frees.load(std::memory_order_relaxed), counters.live_bytes.load(std::memory_order_relaxed),
+				counters.peak_bytes.load(std::memory_order_relaxed) };
+		}
+
+		// starts a new high-water mark from the bytes live right now
+		static void resetPeak()
+		{
+			State& counters = state();
+			counters.peak_bytes.store(counters.live_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+
+		// the process's resident set high-water mark in kB, or 0 where /proc is not available
+		static std::size_t peakResidentKilobytes()
+		{
+			std::ifstream status("/proc/self/status");
+			std::string field;
+			while (status >> field) {
+				if (field == "VmHWM:") {
+					std::size_t kilobytes = 0;
+					status >> kilobytes;
+					return kilobytes;
+				}
+			}
+			return 0;
+		}
+
+		static void* allocate(std::size_t size)
+		{
+			void* block = std::malloc(size != 0 ? size : 1);
+			if (block == nullptr) {
+				return nullptr;
+			}
+			State& counters = state();
+			if (counters.enabled.load(std::memory_order_relaxed)) {
+				std::int64_t bytes = usableSize(block);
+				counters.allocations.fetch_add(1, std::memory_order_relaxed);
+				std::int64_t live = counters.live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+				std::int64_t peak = counters.peak_bytes.load(std::memory_order_relaxed);
+				while (live > peak && !counters.peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+				}
+			}
+			return block;
+		}
+
+		static void deallocate(void* block)
+		{
+			if (block == nullptr) {
+				return;
+			}
+			State& counters = state();
+			if (counters.enabled.load(std::memory_order_relaxed)) {
+				counters.frees.fetch_add(1, std::memory_order_relaxed);
+				counters.live_bytes.fetch_sub(usableSize(block), std::memory_order_relaxed);
+			}
+			std::free(block);
+		}
+
+	private:
+		struct State {
+			std::atomic<bool> enabled;
+			std::atomic<std::int64_t> allocations;
+			std::atomic<std::int64_t> frees;
+			std::atomic<std::int64_t> live_bytes;
+			std::atomic<std::int64_t> peak_bytes;
+		};
+
+		// constant-initialized, so it is usable from allocations made before main
+		static State& state()
+		{
+			static State counters = { { false }, { 0 }, { 0 }, { 0 }, { 0 } };
+			return counters;
+		}
+
+		static std::int64_t usableSize(void* block)
+		{
+#if defined(__GLIBC__)
+			return static_cast<std::int64_t>(malloc_usable_size(block));
+#else
+			(void)block;
+			return 0;
+#endif
+		}
+	};
+
+}
+
+#endif /* AISDI_MEMORYTRACKER_H */
+
+// outside the include guard, so that defining the macro works even when the header came in earlier
+#if defined(AISDI_TRACK_ALLOCATIONS) && !defined(AISDI_MEMORYTRACKER_OPERATORS)
+#define AISDI_MEMORYTRACKER_OPERATORS
+
+void* operator new(std::size_t size)
+{
+	void* block = aisdi::MemoryTracker::allocate(size);
+	if (block == nullptr) {
+		throw std::bad_alloc();
+	}
+	return block;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return aisdi::MemoryTracker::allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return aisdi::MemoryTracker::allocate(size);
+}
+
+void operator delete(void* block) noexcept
+{
+	aisdi::MemoryTracker::deallocate(block);
+}
+
+void operator delete[](void* block) noexcept
+{
+	aisdi::MemoryTracker::deallocate(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept
+{
+	aisdi::MemoryTracker::deallocate(block);
+}
+
+void operator delete[](void* block, std::size_t) noexcept
+{
+	aisdi::MemoryTracker::deallocate(block);
+}
+
+#endif
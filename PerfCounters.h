@@ -0,0 +1,140 @@
+#ifndef AISDI_PERFCOUNTERS_H
+#define AISDI_PERFCOUNTERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace aisdi
+{
+
+	// Hardware counters of the calling thread through Linux perf_event_open, user space only.
+	// Events the kernel refuses (no PMU in a VM or container, perf_event_paranoid, other systems)
+	// are left out, so the counters may be empty; read() then simply returns nothing.
+	class PerfCounters {
+	public:
+		using size_type = std::size_t;
+
+		PerfCounters()
+		{
+#if defined(__linux__)
+			const Event events[] = {
+				{ "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+				{ "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+				{ "l1d_misses", PERF_TYPE_HW_CACHE, cacheEvent(PERF_COUNT_HW_CACHE_L1D) },
+				{ "llc_misses", PERF_TYPE_HW_CACHE, cacheEvent(PERF_COUNT_HW_CACHE_LL) },
+				{ "branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+				{ "dtlb_misses", PERF_TYPE_HW_CACHE, cacheEvent(PERF_COUNT_HW_CACHE_DTLB) },
+			};
+			for (const Event& event : events) {
+				int fd = open(event);
+				if (fd >= 0) {
+					counters.push_back(Counter{ event.name, fd });
+				}
+			}
+#endif
+		}
+
+		PerfCounters(const PerfCounters&) = delete;
+		PerfCounters& operator=(const PerfCounters&) = delete;
+
+		~PerfCounters()
+		{
+#if defined(__linux__)
+			for (const Counter& counter : counters) {
+				::close(counter.fd);
+			}
+#endif
+		}
+
+		bool isAvailable() const
+		{
+			return !counters.empty();
+		}
+
+		// zeroes and starts every counter
+		void start()
+		{
+#if defined(__linux__)
+			for (const Counter& counter : counters) {
+				ioctl(counter.fd, PERF_EVENT_IOC_RESET, 0);
+				ioctl(counter.fd, PERF_EVENT_IOC_ENABLE, 0);
+			}
+#endif
+		}
+
+		void stop()
+		{
+#if defined(__linux__)
+			for (const Counter& counter : counters) {
+				ioctl(counter.fd, PERF_EVENT_IOC_DISABLE, 0);
+			}
+#endif
+		}
+
+		// counts since the last start(), scaled up when the kernel had to multiplex the PMU;
+		// an event that never got scheduled is left out
+		std::vector<std::pair<std::string, double>> read() const
+		{
+			std::vector<std::pair<std::string, double>> values;
+#if defined(__linux__)
+			for (const Counter& counter : counters) {
+				std::uint64_t data[3];
+				if (::read(counter.fd, data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)) || data[2] == 0) {
+					continue;
+				}
+				values.emplace_back(counter.name, static_cast<double>(data[0]) * data[1] / data[2]);
+			}
+#endif
+			return values;
+		}
+
+	private:
+		struct Counter {
+			std::string name;
+			int fd;
+		};
+
+		std::vector<Counter> counters;
+
+#if defined(__linux__)
+		struct Event {
+			const char* name;
+			std::uint32_t type;
+			std::uint64_t config;
+		};
+
+		static std::uint64_t cacheEvent(std::uint64_t cache)
+		{
+			return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		}
+
+		static int open(const Event& event)
+		{
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = event.type;
+			attr.config = event.config;
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+		}
+#endif
+	};
+
+}
+
+#endif /* AISDI_PERFCOUNTERS_H */
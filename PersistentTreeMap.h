@@ -0,0 +1,545 @@
+#ifndef AISDI_MAPS_PERSISTENTTREEMAP_H
+#define AISDI_MAPS_PERSISTENTTREEMAP_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace aisdi
+{
+
+	// Balanced map whose versions share structure. Copying a map (or taking a snapshot) is O(1);
+	// insert and remove copy only the O(log n) nodes on the path that are shared with another version.
+	// Separate map objects may be used from different threads even when they share nodes.
+	template <typename KeyType, typename ValueType, typename Compare = std::less<KeyType>>
+	class PersistentTreeMap {
+	public:
+		using key_type = KeyType;
+		using mapped_type = ValueType;
+		using value_type = std::pair<const key_type, mapped_type>;
+		using size_type = std::size_t;
+		using reference = value_type&;
+		using const_reference = const value_type&;
+		using key_compare = Compare;
+
+		class ConstIterator;
+		using iterator = ConstIterator;
+		using const_iterator = ConstIterator;
+
+		PersistentTreeMap()
+			: PersistentTreeMap(Compare())
+		{}
+
+		explicit PersistentTreeMap(const Compare& comp)
+			: root(nullptr)
+			, size(0)
+			, comp(comp)
+		{}
+
+		PersistentTreeMap(std::initializer_list<value_type> list)
+			: PersistentTreeMap()
+		{
+			for (auto&& it : list) {
+				(*this)[it.first] = it.second;
+			}
+		}
+
+		PersistentTreeMap(const PersistentTreeMap& other)
+			: root(acquire(other.root))
+			, size(other.size)
+			, comp(other.comp)
+		{}
+
+		PersistentTreeMap(PersistentTreeMap&& other)
+			: root(other.root)
+			, size(other.size)
+			, comp(other.comp)
+		{
+			other.root = nullptr;
+			other.size = 0;
+		}
+
+		~PersistentTreeMap()
+		{
+			release(root);
+		}
+
+		PersistentTreeMap& operator=(const PersistentTreeMap& other)
+		{
+			if (this != &other) {
+				Node* old = root;
+				root = acquire(other.root);
+				size = other.size;
+				comp = other.comp;
+				release(old);
+			}
+			return *this;
+		}
+
+		PersistentTreeMap& operator=(PersistentTreeMap&& other)
+		{
+			if (this != &other) {
+				release(root);
+				root = other.root;
+				size = other.size;
+				comp = other.comp;
+				other.root = nullptr;
+				other.size = 0;
+			}
+			return *this;
+		}
+
+		// immutable view of the current version; must be taken by the thread that owns this map
+		PersistentTreeMap snapshot() const
+		{
+			return *this;
+		}
+
+		bool isEmpty() const
+		{
+			return !size;
+		}
+
+		size_type getSize() const
+		{
+			return size;
+		}
+
+		mapped_type& operator[](const key_type& key)
+		{
+			return upsert(root, key);
+		}
+
+		const mapped_type& valueOf(const key_type& key) const
+		{
+			const_iterator search = find(key);
+			if (search == cend()) {
+				throw std::out_of_range("cannot access non-existent element");
+			}
+			return search->second;
+		}
+
+		const_iterator find(const key_type& key) const
+		{
+			const_iterator search = lowerBound(key);
+			if (search != cend() && comp(key, search->first)) {
+				return cend();
+			}
+			return search;
+		}
+
+		const_iterator lowerBound(const key_type& key) const
+		{
+			const_iterator result(*this);
+			size_type depth = 0;
+			for (const Node* temp = root; temp != nullptr; ) {
+				result.path.push_back(temp);
+				if (comp(temp->data.first, key)) {
+					temp = temp->right;
+				}
+				else {
+					depth = result.path.size();
+					temp = temp->left;
+				}
+			}
+			result.path.resize(depth);
+			return result;
+		}
+
+		const_iterator upperBound(const key_type& key) const
+		{
+			const_iterator result(*this);
+			size_type depth = 0;
+			for (const Node* temp = root; temp != nullptr; ) {
+				result.path.push_back(temp);
+				if (comp(key, temp->data.first)) {
+					depth = result.path.size();
+					temp = temp->left;
+				}
+				else {
+					temp = temp->right;
+				}
+			}
+			result.path.resize(depth);
+			return result;
+		}
+
+		void remove(const key_type& key)
+		{
+			if (isEmpty()) {
+				throw std::out_of_range("cannot remove from empty map");
+			}
+			if (!contains(root, key)) {
+				throw std::out_of_range("cannot remove element with non-existent key");
+			}
+			erase(root, key);
+			--size;
+		}
+
+		void remove(const const_iterator& it)
+		{
+			if (it == cend()) {
+				throw std::out_of_range("cannot remove element with non-existent key");
+			}
+			remove(it->first);
+		}
+
+		bool operator==(const PersistentTreeMap& other) const
+		{
+			if (size != other.size) {
+				return false;
+			}
+			if (root == other.root) {
+				return true;
+			}
+
+			auto it_this = begin();
+			auto it_other = other.begin();
+			for (; it_this != end(); ++it_this, ++it_other) {
+				if (*it_this != *it_other) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool operator!=(const PersistentTreeMap& other) const
+		{
+			return !(*this == other);
+		}
+
+		const_iterator cbegin() const
+		{
+			const_iterator result(*this);
+			for (const Node* temp = root; temp != nullptr; temp = temp->left) {
+				result.path.push_back(temp);
+			}
+			return result;
+		}
+
+		const_iterator cend() const
+		{
+			return const_iterator(*this);
+		}
+
+		const_iterator begin() const
+		{
+			return cbegin();
+		}
+
+		const_iterator end() const
+		{
+			return cend();
+		}
+
+	private:
+		class Node {
+		public:
+			value_type data;
+			Node* left;
+			Node* right;
+			int height;
+			std::atomic<size_type> refs;
+
+			Node(const value_type& data, Node* left = nullptr, Node* right = nullptr, int height = 1)
+				: data(data)
+				, left(left)
+				, right(right)
+				, height(height)
+				, refs(1)
+			{}
+		};
+
+		Node* root;
+		size_type size;
+		Compare comp;
+
+		static Node* acquire(Node* node)
+		{
+			if (node != nullptr) {
+				node->refs.fetch_add(1, std::memory_order_relaxed);
+			}
+			return node;
+		}
+
+		static void release(Node* node)
+		{
+			if (node != nullptr && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				release(node->left);
+				release(node->right);
+				delete node;
+			}
+		}
+
+		// unlike find, does not build an iterator path, so a remove allocates only the nodes it copies
+		bool contains(const Node* node, const key_type& key) const
+		{
+			while (node != nullptr) {
+				if (comp(key, node->data.first)) {
+					node = node->left;
+				}
+				else if (comp(node->data.first, key)) {
+					node = node->right;
+				}
+				else {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// copy-on-write: a node referenced only from slot may be modified in place
+		static Node* makeUnique(Node*& slot)
+		{
+			if (slot->refs.load(std::memory_order_acquire) == 1) {
+				return slot;
+			}
+			Node* copy = new Node(slot->data, acquire(slot->left), acquire(slot->right), slot->height);
+			release(slot);
+			slot = copy;
+			return copy;
+		}
+
+		static int height(const Node* node)
+		{
+			return node != nullptr ? node->height : 0;
+		}
+
+		static void updateHeight(Node* node)
+		{
+			node->height = std::max(height(node->left), height(node->right)) + 1;
+		}
+
+		static void rotateRight(Node*& slot)
+		{
+			Node* node = slot;
+			Node* pivot = makeUnique(node->left);
+			node->left = pivot->right;
+			pivot->right = node;
+			updateHeight(node);
+			updateHeight(pivot);
+			slot = pivot;
+		}
+
+		static void rotateLeft(Node*& slot)
+		{
+			Node* node = slot;
+			Node* pivot = makeUnique(node->right);
+			node->right = pivot->left;
+			pivot->left = node;
+			updateHeight(node);
+			updateHeight(pivot);
+			slot = pivot;
+		}
+
+		// slot must already be uniquely owned
+		static void rebalance(Node*& slot)
+		{
+			Node* node = slot;
+			int balance = height(node->left) - height(node->right);
+			if (balance > 1) {
+				Node* left = makeUnique(node->left);
+				if (height(left->left) < height(left->right)) {
+					rotateLeft(node->left);
+				}
+				rotateRight(slot);
+			}
+			else if (balance < -1) {
+				Node* right = makeUnique(node->right);
+				if (height(right->right) < height(right->left)) {
+					rotateRight(node->right);
+				}
+				rotateLeft(slot);
+			}
+			else {
+				updateHeight(node);
+			}
+		}
+
+		mapped_type& upsert(Node*& slot, const key_type& key)
+		{
+			if (slot == nullptr) {
+				slot = new Node(value_type(key, mapped_type()));
+				++size;
+				return slot->data.second;
+			}
+
+			Node* node = makeUnique(slot);
+			mapped_type* result;
+			if (comp(key, node->data.first)) {
+				result = &upsert(node->left, key);
+			}
+			else if (comp(node->data.first, key)) {
+				result = &upsert(node->right, key);
+			}
+			else {
+				return node->data.second;
+			}
+			rebalance(slot);
+			return *result;
+		}
+
+		// unlinks the minimum of the subtree and hands its reference to the caller
+		static Node* detachMin(Node*& slot)
+		{
+			Node* node = makeUnique(slot);
+			if (node->left != nullptr) {
+				Node* min = detachMin(node->left);
+				rebalance(slot);
+				return min;
+			}
+			slot = node->right;
+			node->right = nullptr;
+			return node;
+		}
+
+		void erase(Node*& slot, const key_type& key)
+		{
+			Node* node = makeUnique(slot);
+			if (comp(key, node->data.first)) {
+				erase(node->left, key);
+			}
+			else if (comp(node->data.first, key)) {
+				erase(node->right, key);
+			}
+			else if (node->left == nullptr || node->right == nullptr) {
+				slot = node->left != nullptr ? node->left : node->right;
+				node->left = nullptr;
+				node->right = nullptr;
+				release(node);
+				return;
+			}
+			else {
+				Node* min = detachMin(node->right);
+				min->left = node->left;
+				min->right = node->right;
+				node->left = nullptr;
+				node->right = nullptr;
+				release(node);
+				slot = min;
+			}
+			rebalance(slot);
+		}
+	};
+
+	template <typename KeyType, typename ValueType, typename Compare>
+	class PersistentTreeMap<KeyType, ValueType, Compare>::ConstIterator {
+	public:
+		using reference = typename PersistentTreeMap::const_reference;
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = typename PersistentTreeMap::value_type;
+		using pointer = const typename PersistentTreeMap::value_type*;
+
+		friend class PersistentTreeMap;
+
+		explicit ConstIterator(const PersistentTreeMap& parent)
+			: parent(&parent)
+		{}
+
+		ConstIterator& operator++()
+		{
+			if (path.empty()) {
+				throw std::out_of_range("cannot increment end() iterator");
+			}
+
+			const Node* node = path.back();
+			if (node->right != nullptr) {
+				for (node = node->right; node != nullptr; node = node->left) {
+					path.push_back(node);
+				}
+				return *this;
+			}
+
+			const Node* child;
+			do {
+				child = path.back();
+				path.pop_back();
+			} while (!path.empty() && path.back()->right == child);
+			return *this;
+		}
+
+		ConstIterator operator++(int)
+		{
+			ConstIterator copy = *this;
+			++(*this);
+			return copy;
+		}
+
+		ConstIterator& operator--()
+		{
+			if (path.empty()) {
+				for (const Node* node = parent->root; node != nullptr; node = node->right) {
+					path.push_back(node);
+				}
+				if (path.empty()) {
+					throw std::out_of_range("cannot decrement begin() iterator");
+				}
+				return *this;
+			}
+
+			const Node* node = path.back();
+			if (node->left != nullptr) {
+				for (node = node->left; node != nullptr; node = node->right) {
+					path.push_back(node);
+				}
+				return *this;
+			}
+
+			size_type depth = path.size() - 1;
+			while (depth != 0 && path[depth - 1]->left == path[depth]) {
+				--depth;
+			}
+			if (depth == 0) {
+				throw std::out_of_range("cannot decrement begin() iterator");
+			}
+			path.resize(depth);
+			return *this;
+		}
+
+		ConstIterator operator--(int)
+		{
+			ConstIterator copy = *this;
+			--(*this);
+			return copy;
+		}
+
+		reference operator*() const
+		{
+			if (path.empty()) {
+				throw std::out_of_range("cannot dereference end() iterator");
+			}
+			return path.back()->data;
+		}
+
+		pointer operator->() const
+		{
+			return &this->operator*();
+		}
+
+		bool operator==(const ConstIterator& other) const
+		{
+			if (path.empty() || other.path.empty()) {
+				return path.empty() && other.path.empty();
+			}
+			return path.back() == other.path.back();
+		}
+
+		bool operator!=(const ConstIterator& other) const
+		{
+			return !(*this == other);
+		}
+
+	private:
+		const PersistentTreeMap* parent;
+		// ancestors of the current element, root first; empty for end()
+		std::vector<const Node*> path;
+	};
+
+}
+
+#endif /* AISDI_MAPS_PERSISTENTTREEMAP_H */
@@ -0,0 +1,1166 @@
+#ifndef AISDI_MAPS_RADIXTREEMAP_H
+#define AISDI_MAPS_RADIXTREEMAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace aisdi
+{
+
+	// Describes a key as a string of bytes whose lexicographic order is the key order.
+	template <typename KeyType, typename Enable = void>
+	struct RadixKeyTraits;
+
+	// big-endian with the sign bit flipped, so negative numbers sort first
+	template <typename KeyType>
+	struct RadixKeyTraits<KeyType, typename std::enable_if<std::is_integral<KeyType>::value>::type> {
+		using Unsigned = typename std::make_unsigned<KeyType>::type;
+
+		static std::size_t length(const KeyType&)
+		{
+			return sizeof(KeyType);
+		}
+
+		static unsigned char byteAt(const KeyType& key, std::size_t index)
+		{
+			Unsigned bits = static_cast<Unsigned>(key);
+			if (std::is_signed<KeyType>::value) {
+				bits ^= static_cast<Unsigned>(Unsigned(1) << (sizeof(KeyType) * 8 - 1));
+			}
+			return static_cast<unsigned char>(bits >> ((sizeof(KeyType) - 1 - index) * 8));
+		}
+	};
+
+	template <>
+	struct RadixKeyTraits<std::string> {
+		static std::size_t length(const std::string& key)
+		{
+			return key.size();
+		}
+
+		static unsigned char byteAt(const std::string& key, std::size_t index)
+		{
+			return static_cast<unsigned char>(key[index]);
+		}
+	};
+
+	// Adaptive radix tree: inner nodes branch on one key byte and grow through 4, 16, 48 and 256
+	// children as they fill up. Runs of bytes shared by a whole subtree are stored once in the node
+	// (path compression). Leaves are threaded in key order, like TreeMap nodes, for iteration.
+	// A key that is a prefix of other keys is kept in the terminal slot of the node where it ends.
+	template <typename KeyType, typename ValueType, typename Traits = RadixKeyTraits<KeyType>>
+	class RadixTreeMap {
+	public:
+		using key_type = KeyType;
+		using mapped_type = ValueType;
+		using value_type = std::pair<const key_type, mapped_type>;
+		using size_type = std::size_t;
+		using reference = value_type&;
+		using const_reference = const value_type&;
+
+		class ConstIterator;
+		class Iterator;
+		using iterator = Iterator;
+		using const_iterator = ConstIterator;
+
+		RadixTreeMap()
+			: root(nullptr)
+			, first(nullptr)
+			, last(nullptr)
+			, size(0)
+		{}
+
+		RadixTreeMap(std::initializer_list<value_type> list)
+			: RadixTreeMap()
+		{
+			for (auto&& it : list) {
+				(*this)[it.first] = it.second;
+			}
+		}
+
+		RadixTreeMap(const RadixTreeMap& other)
+			: RadixTreeMap()
+		{
+			copyFrom(other);
+		}
+
+		RadixTreeMap(RadixTreeMap&& other)
+			: root(other.root)
+			, first(other.first)
+			, last(other.last)
+			, size(other.size)
+		{
+			other.root = nullptr;
+			other.first = nullptr;
+			other.last = nullptr;
+			other.size = 0;
+		}
+
+		~RadixTreeMap()
+		{
+			clear();
+		}
+
+		RadixTreeMap& operator=(const RadixTreeMap& other)
+		{
+			if (this != &other) {
+				clear();
+				copyFrom(other);
+			}
+			return *this;
+		}
+
+		RadixTreeMap& operator=(RadixTreeMap&& other)
+		{
+			if (this != &other) {
+				clear();
+				root = other.root;
+				first = other.first;
+				last = other.last;
+				size = other.size;
+				other.root = nullptr;
+				other.first = nullptr;
+				other.last = nullptr;
+				other.size = 0;
+			}
+			return *this;
+		}
+
+		bool isEmpty() const
+		{
+			return !size;
+		}
+
+		void clear()
+		{
+			destroy(root);
+			root = nullptr;
+			first = nullptr;
+			last = nullptr;
+			size = 0;
+		}
+
+		mapped_type& operator[](const key_type& key)
+		{
+			Leaf* successor = lowerBoundLeaf(root, key, 0);
+			if (successor != nullptr && successor->data.first == key) {
+				return successor->data.second;
+			}
+
+			Leaf* leaf = new Leaf(value_type(key, mapped_type()));
+			insert(root, leaf, 0);
+			linkBefore(successor, leaf);
+			++size;
+			return leaf->data.second;
+		}
+
+		const mapped_type& valueOf(const key_type& key) const
+		{
+			const Leaf* leaf = findLeaf(key);
+			if (leaf == nullptr) {
+				throw std::out_of_range("cannot access non-existent element");
+			}
+			return leaf->data.second;
+		}
+
+		mapped_type& valueOf(const key_type& key)
+		{
+			Leaf* leaf = findLeaf(key);
+			if (leaf == nullptr) {
+				throw std::out_of_range("cannot access non-existent element");
+			}
+			return leaf->data.second;
+		}
+
+		const_iterator find(const key_type& key) const
+		{
+			return const_iterator(*this, findLeaf(key));
+		}
+
+		iterator find(const key_type& key)
+		{
+			return iterator(*this, findLeaf(key));
+		}
+
+		const_iterator lowerBound(const key_type& key) const
+		{
+			return const_iterator(*this, lowerBoundLeaf(root, key, 0));
+		}
+
+		iterator lowerBound(const key_type& key)
+		{
+			return iterator(*this, lowerBoundLeaf(root, key, 0));
+		}
+
+		const_iterator upperBound(const key_type& key) const
+		{
+			return const_iterator(*this, upperBoundLeaf(key));
+		}
+
+		iterator upperBound(const key_type& key)
+		{
+			return iterator(*this, upperBoundLeaf(key));
+		}
+
+		void remove(const key_type& key)
+		{
+			remove(find(key));
+		}
+
+		void remove(const const_iterator& it)
+		{
+			if (isEmpty()) {
+				throw std::out_of_range("cannot remove from empty map");
+			}
+
+			if (it == end()) {
+				throw std::out_of_range("cannot remove element with non-existent key");
+			}
+
+			Leaf* leaf = it.node;
+			erase(root, leaf->data.first, 0);
+			unlink(leaf);
+			delete leaf;
+			--size;
+		}
+
+		size_type getSize() const
+		{
+			return size;
+		}
+
+		bool operator==(const RadixTreeMap& other) const
+		{
+			if (size != other.size) {
+				return false;
+			}
+
+			auto it_this = begin();
+			auto it_other = other.begin();
+			for (; it_this != end(); ++it_this, ++it_other) {
+				if (*it_this != *it_other) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool operator!=(const RadixTreeMap& other) const
+		{
+			return !(*this == other);
+		}
+
+		iterator begin()
+		{
+			return iterator(*this, first);
+		}
+
+		iterator end()
+		{
+			return iterator(*this, nullptr);
+		}
+
+		const_iterator cbegin() const
+		{
+			return const_iterator(*this, first);
+		}
+
+		const_iterator cend() const
+		{
+			return const_iterator(*this, nullptr);
+		}
+
+		const_iterator begin() const
+		{
+			return cbegin();
+		}
+
+		const_iterator end() const
+		{
+			return cend();
+		}
+
+	private:
+		// longer prefixes keep only their head in the node and read the rest from a leaf below it
+		static const size_type MAX_PREFIX = 8;
+
+		enum class NodeType : unsigned char {
+			Leaf,
+			Node4,
+			Node16,
+			Node48,
+			Node256
+		};
+
+		struct Node {
+			explicit Node(NodeType type)
+				: type(type)
+			{}
+
+			NodeType type;
+		};
+
+		struct Leaf : Node {
+			explicit Leaf(const value_type& data)
+				: Node(NodeType::Leaf)
+				, data(data)
+				, prev(nullptr)
+				, next(nullptr)
+			{}
+
+			value_type data;
+			Leaf* prev;
+			Leaf* next;
+		};
+
+		struct Inner : Node {
+			explicit Inner(NodeType type)
+				: Node(type)
+				, count(0)
+				, prefix_length(0)
+				, terminal(nullptr)
+			{}
+
+			unsigned short count;
+			size_type prefix_length;
+			unsigned char prefix[MAX_PREFIX];
+			// the key that ends right after this node's prefix
+			Leaf* terminal;
+		};
+
+		// Node4 and Node16 keep their bytes sorted
+		struct Node4 : Inner {
+			Node4()
+				: Inner(NodeType::Node4)
+			{}
+
+			unsigned char keys[4];
+			Node* children[4];
+		};
+
+		struct Node16 : Inner {
+			Node16()
+				: Inner(NodeType::Node16)
+			{}
+
+			unsigned char keys[16];
+			Node* children[16];
+		};
+
+		// index holds slot + 1 for every byte present, 0 otherwise
+		struct Node48 : Inner {
+			Node48()
+				: Inner(NodeType::Node48)
+			{
+				std::fill(index, index + 256, 0);
+				std::fill(children, children + 48, nullptr);
+			}
+
+			unsigned char index[256];
+			Node* children[48];
+		};
+
+		struct Node256 : Inner {
+			Node256()
+				: Inner(NodeType::Node256)
+			{
+				std::fill(children, children + 256, nullptr);
+			}
+
+			Node* children[256];
+		};
+
+		Node* root;
+		Leaf* first;
+		Leaf* last;
+		size_type size;
+
+		static size_type length(const key_type& key)
+		{
+			return Traits::length(key);
+		}
+
+		static unsigned char byteAt(const key_type& key, size_type index)
+		{
+			return Traits::byteAt(key, index);
+		}
+
+		static Leaf* asLeaf(Node* node)
+		{
+			return static_cast<Leaf*>(node);
+		}
+
+		static Inner* asInner(Node* node)
+		{
+			return static_cast<Inner*>(node);
+		}
+
+		void copyFrom(const RadixTreeMap& other)
+		{
+			for (const Leaf* leaf = other.first; leaf != nullptr; leaf = leaf->next) {
+				Leaf* copy = new Leaf(leaf->data);
+				insert(root, copy, 0);
+				linkBefore(nullptr, copy);
+				++size;
+			}
+		}
+
+		static void destroy(Node* node)
+		{
+			if (node == nullptr) {
+				return;
+			}
+
+			switch (node->type) {
+			case NodeType::Leaf:
+				delete asLeaf(node);
+				return;
+			case NodeType::Node4: {
+				Node4* inner = static_cast<Node4*>(node);
+				for (unsigned i = 0; i < inner->count; ++i) {
+					destroy(inner->children[i]);
+				}
+				delete inner->terminal;
+				delete inner;
+				return;
+			}
+			case NodeType::Node16: {
+				Node16* inner = static_cast<Node16*>(node);
+				for (unsigned i = 0; i < inner->count; ++i) {
+					destroy(inner->children[i]);
+				}
+				delete inner->terminal;
+				delete inner;
+				return;
+			}
+			case NodeType::Node48: {
+				Node48* inner = static_cast<Node48*>(node);
+				for (unsigned i = 0; i < 48; ++i) {
+					destroy(inner->children[i]);
+				}
+				delete inner->terminal;
+				delete inner;
+				return;
+			}
+			case NodeType::Node256: {
+				Node256* inner = static_cast<Node256*>(node);
+				for (unsigned i = 0; i < 256; ++i) {
+					destroy(inner->children[i]);
+				}
+				delete inner->terminal;
+				delete inner;
+				return;
+			}
+			}
+		}
+
+		// the child slot for byte, or nullptr when there is none
+		static Node** findChild(Inner* node, unsigned char byte)
+		{
+			switch (node->type) {
+			case NodeType::Node4: {
+				Node4* inner = static_cast<Node4*>(node);
+				for (unsigned i = 0; i < inner->count; ++i) {
+					if (inner->keys[i] == byte) {
+						return &inner->children[i];
+					}
+				}
+				return nullptr;
+			}
+			case NodeType::Node16: {
+				Node16* inner = static_cast<Node16*>(node);
+#if defined(__SSE2__)
+				__m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inner->keys));
+				int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(keys, _mm_set1_epi8(static_cast<char>(byte))));
+				mask &= (1 << inner->count) - 1;
+				return mask != 0 ? &inner->children[__builtin_ctz(mask)] : nullptr;
+#else
+				for (unsigned i = 0; i < inner->count; ++i) {
+					if (inner->keys[i] == byte) {
+						return &inner->children[i];
+					}
+				}
+				return nullptr;
+#endif
+			}
+			case NodeType::Node48: {
+				Node48* inner = static_cast<Node48*>(node);
+				return inner->index[byte] != 0 ? &inner->children[inner->index[byte] - 1] : nullptr;
+			}
+			case NodeType::Node256: {
+				Node256* inner = static_cast<Node256*>(node);
+				return inner->children[byte] != nullptr ? &inner->children[byte] : nullptr;
+			}
+			default:
+				return nullptr;
+			}
+		}
+
+		// position of the first byte not less than byte among count sorted bytes
+		static unsigned lowerPosition(const unsigned char* keys, unsigned count, unsigned char byte)
+		{
+			unsigned i = 0;
+			while (i < count && keys[i] < byte) {
+				++i;
+			}
+			return i;
+		}
+
+		static unsigned lowerPosition16(const Node16* inner, unsigned char byte)
+		{
+#if defined(__SSE2__)
+			// unsigned keys[i] >= byte exactly when max(keys[i], byte) == keys[i]
+			__m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inner->keys));
+			__m128i not_less = _mm_cmpeq_epi8(_mm_max_epu8(keys, _mm_set1_epi8(static_cast<char>(byte))), keys);
+			int mask = _mm_movemask_epi8(not_less) & ((1 << inner->count) - 1);
+			return mask != 0 ? __builtin_ctz(mask) : inner->count;
+#else
+			return lowerPosition(inner->keys, inner->count, byte);
+#endif
+		}
+
+		// the first child whose byte is greater than byte (or any child, if inclusive and equal)
+		static Node* childFrom(Inner* node, unsigned byte)
+		{
+			switch (node->type) {
+			case NodeType::Node4: {
+				Node4* inner = static_cast<Node4*>(node);
+				if (byte > 255) {
+					return nullptr;
+				}
+				unsigned i = lowerPosition(inner->keys, inner->count, static_cast<unsigned char>(byte));
+				return i < inner->count ? inner->children[i] : nullptr;
+			}
+			case NodeType::Node16: {
+				Node16* inner = static_cast<Node16*>(node);
+				if (byte > 255) {
+					return nullptr;
+				}
+				unsigned i = lowerPosition16(inner, static_cast<unsigned char>(byte));
+				return i < inner->count ? inner->children[i] : nullptr;
+			}
+			case NodeType::Node48: {
+				Node48* inner = static_cast<Node48*>(node);
+				for (; byte < 256; ++byte) {
+					if (inner->index[byte] != 0) {
+						return inner->children[inner->index[byte] - 1];
+					}
+				}
+				return nullptr;
+			}
+			case NodeType::Node256: {
+				Node256* inner = static_cast<Node256*>(node);
+				for (; byte < 256; ++byte) {
+					if (inner->children[byte] != nullptr) {
+						return inner->children[byte];
+					}
+				}
+				return nullptr;
+			}
+			default:
+				return nullptr;
+			}
+		}
+
+		static Leaf* minimum(Node* node)
+		{
+			while (node->type != NodeType::Leaf) {
+				Inner* inner = asInner(node);
+				if (inner->terminal != nullptr) {
+					return inner->terminal;
+				}
+				node = childFrom(inner, 0);
+			}
+			return asLeaf(node);
+		}
+
+		// byte i of the node's prefix, which starts at key position depth
+		static unsigned char prefixAt(Inner* node, size_type i, size_type depth)
+		{
+			if (i < MAX_PREFIX) {
+				return node->prefix[i];
+			}
+			return byteAt(minimum(node)->data.first, depth + i);
+		}
+
+		// how many leading bytes of the prefix the key matches; stops early where the key ends
+		static size_type prefixMismatch(Inner* node, const key_type& key, size_type depth)
+		{
+			size_type limit = std::min(node->prefix_length, length(key) - depth);
+			size_type i = 0;
+			for (size_type stored = limit < MAX_PREFIX ? limit : MAX_PREFIX; i < stored; ++i) {
+				if (node->prefix[i] != byteAt(key, depth + i)) {
+					return i;
+				}
+			}
+			if (i < limit) {
+				const key_type& other = minimum(node)->data.first;
+				for (; i < limit; ++i) {
+					if (byteAt(other, depth + i) != byteAt(key, depth + i)) {
+						return i;
+					}
+				}
+			}
+			return i;
+		}
+
+		// optimistic descent: bytes past MAX_PREFIX are skipped and checked against the leaf instead
+		Leaf* findLeaf(const key_type& key) const
+		{
+			size_type key_length = length(key);
+			size_type depth = 0;
+			Node* node = root;
+			while (node != nullptr) {
+				if (node->type == NodeType::Leaf) {
+					Leaf* leaf = asLeaf(node);
+					return leaf->data.first == key ? leaf : nullptr;
+				}
+
+				Inner* inner = asInner(node);
+				if (inner->prefix_length != 0) {
+					if (depth + inner->prefix_length > key_length) {
+						return nullptr;
+					}
+					for (size_type i = 0; i < inner->prefix_length && i < MAX_PREFIX; ++i) {
+						if (inner->prefix[i] != byteAt(key, depth + i)) {
+							return nullptr;
+						}
+					}
+					depth += inner->prefix_length;
+				}
+
+				if (depth == key_length) {
+					Leaf* leaf = inner->terminal;
+					return leaf != nullptr && leaf->data.first == key ? leaf : nullptr;
+				}
+				Node** child = findChild(inner, byteAt(key, depth++));
+				node = child != nullptr ? *child : nullptr;
+			}
+			return nullptr;
+		}
+
+		// the first leaf of the subtree whose key is not less than key; the bytes before depth match
+		static Leaf* lowerBoundLeaf(Node* node, const key_type& key, size_type depth)
+		{
+			if (node == nullptr) {
+				return nullptr;
+			}
+
+			size_type key_length = length(key);
+			if (node->type == NodeType::Leaf) {
+				const key_type& other = asLeaf(node)->data.first;
+				size_type other_length = length(other);
+				for (size_type i = depth; i < key_length && i < other_length; ++i) {
+					unsigned char a = byteAt(other, i);
+					unsigned char b = byteAt(key, i);
+					if (a != b) {
+						return a > b ? asLeaf(node) : nullptr;
+					}
+				}
+				return other_length >= key_length ? asLeaf(node) : nullptr;
+			}
+
+			Inner* inner = asInner(node);
+			for (size_type i = 0; i < inner->prefix_length; ++i) {
+				if (depth + i == key_length) {
+					return minimum(node);
+				}
+				unsigned char a = prefixAt(inner, i, depth);
+				unsigned char b = byteAt(key, depth + i);
+				if (a != b) {
+					return a > b ? minimum(node) : nullptr;
+				}
+			}
+			depth += inner->prefix_length;
+
+			if (depth == key_length) {
+				return minimum(node);
+			}
+			unsigned char byte = byteAt(key, depth);
+			Node** child = findChild(inner, byte);
+			if (child != nullptr) {
+				Leaf* result = lowerBoundLeaf(*child, key, depth + 1);
+				if (result != nullptr) {
+					return result;
+				}
+			}
+			Node* next = childFrom(inner, byte + 1u);
+			return next != nullptr ? minimum(next) : nullptr;
+		}
+
+		Leaf* upperBoundLeaf(const key_type& key) const
+		{
+			Leaf* leaf = lowerBoundLeaf(root, key, 0);
+			if (leaf != nullptr && leaf->data.first == key) {
+				leaf = leaf->next;
+			}
+			return leaf;
+		}
+
+		void linkBefore(Leaf* successor, Leaf* leaf)
+		{
+			leaf->next = successor;
+			leaf->prev = successor != nullptr ? successor->prev : last;
+			(leaf->prev != nullptr ? leaf->prev->next : first) = leaf;
+			(successor != nullptr ? successor->prev : last) = leaf;
+		}
+
+		void unlink(Leaf* leaf)
+		{
+			(leaf->prev != nullptr ? leaf->prev->next : first) = leaf->next;
+			(leaf->next != nullptr ? leaf->next->prev : last) = leaf->prev;
+		}
+
+		static void setPrefix(Inner* node, const key_type& key, size_type from, size_type count)
+		{
+			node->prefix_length = count;
+			for (size_type i = 0; i < count && i < MAX_PREFIX; ++i) {
+				node->prefix[i] = byteAt(key, from + i);
+			}
+		}
+
+		// hangs leaf under node at the given key position: in the terminal slot if its key ends there
+		static void place(Node*& ref, Leaf* leaf, size_type depth)
+		{
+			Inner* inner = asInner(ref);
+			if (depth == length(leaf->data.first)) {
+				inner->terminal = leaf;
+			}
+			else {
+				addChild(ref, byteAt(leaf->data.first, depth), leaf);
+			}
+		}
+
+		// the key of leaf must not be in the tree yet
+		static void insert(Node*& ref, Leaf* leaf, size_type depth)
+		{
+			const key_type& key = leaf->data.first;
+			if (ref == nullptr) {
+				ref = leaf;
+				return;
+			}
+
+			if (ref->type == NodeType::Leaf) {
+				const key_type& other = asLeaf(ref)->data.first;
+				size_type limit = std::min(length(key), length(other));
+				size_type common = depth;
+				while (common < limit && byteAt(key, common) == byteAt(other, common)) {
+					++common;
+				}
+
+				Node* split = new Node4();
+				setPrefix(asInner(split), key, depth, common - depth);
+				place(split, asLeaf(ref), common);
+				place(split, leaf, common);
+				ref = split;
+				return;
+			}
+
+			Inner* inner = asInner(ref);
+			if (inner->prefix_length != 0) {
+				size_type matched = prefixMismatch(inner, key, depth);
+				if (matched < inner->prefix_length) {
+					// the new leaf branches off inside the prefix: split it at the first differing byte
+					Node* split = new Node4();
+					setPrefix(asInner(split), key, depth, matched);
+					unsigned char edge = prefixAt(inner, matched, depth);
+					trimPrefix(inner, matched + 1, depth);
+					addChild(split, edge, ref);
+					place(split, leaf, depth + matched);
+					ref = split;
+					return;
+				}
+				depth += inner->prefix_length;
+			}
+
+			if (depth == length(key)) {
+				inner->terminal = leaf;
+				return;
+			}
+			Node** child = findChild(inner, byteAt(key, depth));
+			if (child != nullptr) {
+				insert(*child, leaf, depth + 1);
+			}
+			else {
+				addChild(ref, byteAt(key, depth), leaf);
+			}
+		}
+
+		// drops the first count bytes of the prefix
+		static void trimPrefix(Inner* node, size_type count, size_type depth)
+		{
+			size_type remaining = node->prefix_length - count;
+			if (node->prefix_length <= MAX_PREFIX) {
+				std::memmove(node->prefix, node->prefix + count, remaining);
+			}
+			else {
+				const key_type& key = minimum(node)->data.first;
+				for (size_type i = 0; i < remaining && i < MAX_PREFIX; ++i) {
+					node->prefix[i] = byteAt(key, depth + count + i);
+				}
+			}
+			node->prefix_length = remaining;
+		}
+
+		static void copyHeader(Inner* to, const Inner* from)
+		{
+			to->count = from->count;
+			to->prefix_length = from->prefix_length;
+			std::memcpy(to->prefix, from->prefix, MAX_PREFIX);
+			to->terminal = from->terminal;
+		}
+
+		static void addChild(Node*& ref, unsigned char byte, Node* child)
+		{
+			switch (ref->type) {
+			case NodeType::Node4: {
+				Node4* inner = static_cast<Node4*>(ref);
+				if (inner->count == 4) {
+					Node16* grown = new Node16();
+					copyHeader(grown, inner);
+					std::copy(inner->keys, inner->keys + 4, grown->keys);
+					std::copy(inner->children, inner->children + 4, grown->children);
+					delete inner;
+					ref = grown;
+					addChild(ref, byte, child);
+					return;
+				}
+				unsigned i = lowerPosition(inner->keys, inner->count, byte);
+				std::copy_backward(inner->keys + i, inner->keys + inner->count, inner->keys + inner->count + 1);
+				std::copy_backward(inner->children + i, inner->children + inner->count, inner->children + inner->count + 1);
+				inner->keys[i] = byte;
+				inner->children[i] = child;
+				++inner->count;
+				return;
+			}
+			case NodeType::Node16: {
+				Node16* inner = static_cast<Node16*>(ref);
+				if (inner->count == 16) {
+					Node48* grown = new Node48();
+					copyHeader(grown, inner);
+					for (unsigned i = 0; i < 16; ++i) {
+						grown->index[inner->keys[i]] = static_cast<unsigned char>(i + 1);
+						grown->children[i] = inner->children[i];
+					}
+					delete inner;
+					ref = grown;
+					addChild(ref, byte, child);
+					return;
+				}
+				unsigned i = lowerPosition16(inner, byte);
+				std::copy_backward(inner->keys + i, inner->keys + inner->count, inner->keys + inner->count + 1);
+				std::copy_backward(inner->children + i, inner->children + inner->count, inner->children + inner->count + 1);
+				inner->keys[i] = byte;
+				inner->children[i] = child;
+				++inner->count;
+				return;
+			}
+			case NodeType::Node48: {
+				Node48* inner = static_cast<Node48*>(ref);
+				if (inner->count == 48) {
+					Node256* grown = new Node256();
+					copyHeader(grown, inner);
+					for (unsigned b = 0; b < 256; ++b) {
+						if (inner->index[b] != 0) {
+							grown->children[b] = inner->children[inner->index[b] - 1];
+						}
+					}
+					delete inner;
+					ref = grown;
+					addChild(ref, byte, child);
+					return;
+				}
+				unsigned slot = 0;
+				while (inner->children[slot] != nullptr) {
+					++slot;
+				}
+				inner->children[slot] = child;
+				inner->index[byte] = static_cast<unsigned char>(slot + 1);
+				++inner->count;
+				return;
+			}
+			case NodeType::Node256: {
+				Node256* inner = static_cast<Node256*>(ref);
+				inner->children[byte] = child;
+				++inner->count;
+				return;
+			}
+			default:
+				return;
+			}
+		}
+
+		static void removeChild(Node*& ref, unsigned char byte)
+		{
+			switch (ref->type) {
+			case NodeType::Node4: {
+				Node4* inner = static_cast<Node4*>(ref);
+				unsigned i = lowerPosition(inner->keys, inner->count, byte);
+				std::copy(inner->keys + i + 1, inner->keys + inner->count, inner->keys + i);
+				std::copy(inner->children + i + 1, inner->children + inner->count, inner->children + i);
+				--inner->count;
+				return;
+			}
+			case NodeType::Node16: {
+				Node16* inner = static_cast<Node16*>(ref);
+				unsigned i = lowerPosition16(inner, byte);
+				std::copy(inner->keys + i + 1, inner->keys + inner->count, inner->keys + i);
+				std::copy(inner->children + i + 1, inner->children + inner->count, inner->children + i);
+				if (--inner->count == 3) {
+					Node4* shrunk = new Node4();
+					copyHeader(shrunk, inner);
+					std::copy(inner->keys, inner->keys + 3, shrunk->keys);
+					std::copy(inner->children, inner->children + 3, shrunk->children);
+					delete inner;
+					ref = shrunk;
+				}
+				return;
+			}
+			case NodeType::Node48: {
+				Node48* inner = static_cast<Node48*>(ref);
+				inner->children[inner->index[byte] - 1] = nullptr;
+				inner->index[byte] = 0;
+				if (--inner->count == 12) {
+					Node16* shrunk = new Node16();
+					copyHeader(shrunk, inner);
+					unsigned i = 0;
+					for (unsigned b = 0; b < 256; ++b) {
+						if (inner->index[b] != 0) {
+							shrunk->keys[i] = static_cast<unsigned char>(b);
+							shrunk->children[i++] = inner->children[inner->index[b] - 1];
+						}
+					}
+					delete inner;
+					ref = shrunk;
+				}
+				return;
+			}
+			case NodeType::Node256: {
+				Node256* inner = static_cast<Node256*>(ref);
+				inner->children[byte] = nullptr;
+				if (--inner->count == 37) {
+					Node48* shrunk = new Node48();
+					copyHeader(shrunk, inner);
+					unsigned slot = 0;
+					for (unsigned b = 0; b < 256; ++b) {
+						if (inner->children[b] != nullptr) {
+							shrunk->index[b] = static_cast<unsigned char>(slot + 1);
+							shrunk->children[slot++] = inner->children[b];
+						}
+					}
+					delete inner;
+					ref = shrunk;
+				}
+				return;
+			}
+			default:
+				return;
+			}
+		}
+
+		// replaces a Node4 left with a single entry by that entry, folding its prefix into the child
+		static void collapse(Node*& ref, size_type depth)
+		{
+			Node4* inner = static_cast<Node4*>(ref);
+			if (inner->count == 0) {
+				ref = inner->terminal;
+				delete inner;
+				return;
+			}
+			if (inner->count != 1 || inner->terminal != nullptr) {
+				return;
+			}
+
+			Node* child = inner->children[0];
+			if (child->type != NodeType::Leaf) {
+				Inner* below = asInner(child);
+				unsigned char joined[MAX_PREFIX];
+				size_type length = 0;
+				for (size_type i = 0; i < inner->prefix_length && length < MAX_PREFIX; ++i) {
+					joined[length++] = prefixAt(inner, i, depth);
+				}
+				if (length < MAX_PREFIX) {
+					joined[length++] = inner->keys[0];
+				}
+				for (size_type i = 0; i < below->prefix_length && length < MAX_PREFIX; ++i) {
+					joined[length++] = below->prefix[i];
+				}
+				std::memcpy(below->prefix, joined, length);
+				below->prefix_length += inner->prefix_length + 1;
+			}
+			ref = child;
+			delete inner;
+		}
+
+		// unhooks the leaf holding key, which must be present; the leaf itself is not freed
+		static void erase(Node*& ref, const key_type& key, size_type depth)
+		{
+			if (ref->type == NodeType::Leaf) {
+				ref = nullptr;
+				return;
+			}
+
+			Inner* inner = asInner(ref);
+			size_type node_depth = depth;
+			depth += inner->prefix_length;
+			if (depth == length(key)) {
+				inner->terminal = nullptr;
+			}
+			else {
+				unsigned char byte = byteAt(key, depth);
+				Node** child = findChild(inner, byte);
+				erase(*child, key, depth + 1);
+				if (*child != nullptr) {
+					return;
+				}
+				removeChild(ref, byte);
+			}
+			if (ref->type == NodeType::Node4) {
+				collapse(ref, node_depth);
+			}
+		}
+	};
+
+	template <typename KeyType, typename ValueType, typename Traits>
+	class RadixTreeMap<KeyType, ValueType, Traits>::ConstIterator {
+	public:
+		using reference = typename RadixTreeMap::const_reference;
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = typename RadixTreeMap::value_type;
+		using pointer = const typename RadixTreeMap::value_type*;
+
+		friend class RadixTreeMap;
+
+		explicit ConstIterator(const RadixTreeMap& parent, Leaf* node)
+			: parent(&parent)
+			, node(node)
+		{}
+
+		ConstIterator& operator++()
+		{
+			if (node == nullptr) {
+				throw std::out_of_range("cannot increment end() iterator");
+			}
+
+			node = node->next;
+			return *this;
+		}
+
+		ConstIterator operator++(int)
+		{
+			ConstIterator copy = *this;
+			++(*this);
+			return copy;
+		}
+
+		ConstIterator& operator--()
+		{
+			if (node == parent->first) {
+				throw std::out_of_range("cannot decrement begin() iterator");
+			}
+
+			node = node == nullptr ? parent->last : node->prev;
+			return *this;
+		}
+
+		ConstIterator operator--(int)
+		{
+			ConstIterator copy = *this;
+			--(*this);
+			return copy;
+		}
+
+		reference operator*() const
+		{
+			if (node == nullptr) {
+				throw std::out_of_range("cannot dereference end() iterator");
+			}
+
+			return node->data;
+		}
+
+		pointer operator->() const
+		{
+			return &this->operator*();
+		}
+
+		bool operator==(const ConstIterator& other) const
+		{
+			return node == other.node;
+		}
+
+		bool operator!=(const ConstIterator& other) const
+		{
+			return !(*this == other);
+		}
+
+	protected:
+		const RadixTreeMap* parent;
+		Leaf* node;
+	};
+
+	template <typename KeyType, typename ValueType, typename Traits>
+	class RadixTreeMap<KeyType, ValueType, Traits>::Iterator : public RadixTreeMap<KeyType, ValueType, Traits>::ConstIterator {
+	public:
+		using reference = typename RadixTreeMap::reference;
+		using pointer = typename RadixTreeMap::value_type*;
+
+		explicit Iterator(const RadixTreeMap& parent, Leaf* node)
+			: ConstIterator(parent, node)
+		{}
+
+		Iterator(const ConstIterator& other)
+			: ConstIterator(other)
+		{}
+
+		Iterator& operator++()
+		{
+			ConstIterator::operator++();
+			return *this;
+		}
+
+		Iterator operator++(int)
+		{
+			auto result = *this;
+			ConstIterator::operator++();
+			return result;
+		}
+
+		Iterator& operator--()
+		{
+			ConstIterator::operator--();
+			return *this;
+		}
+
+		Iterator operator--(int)
+		{
+			auto result = *this;
+			ConstIterator::operator--();
+			return result;
+		}
+
+		pointer operator->() const
+		{
+			return &this->operator*();
+		}
+
+		reference operator*() const
+		{
+			return const_cast<reference>(ConstIterator::operator*());
+		}
+	};
+
+}
+
+#endif /* AISDI_MAPS_RADIXTREEMAP_H */
@@ -0,0 +1,234 @@
+#ifndef AISDI_MAPS_STDMAPADAPTER_H
+#define AISDI_MAPS_STDMAPADAPTER_H
+
+#include "ThreadPool.h"
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace aisdi
+{
+
+	// Gives std::map, std::unordered_map or anything with their interface the vocabulary of the maps
+	// in this repository, so the benchmarks can run them as baselines. Parallel traversal splits
+	// hash maps by bucket like HashMap does; ordered maps are cut into equal runs of elements,
+	// which takes one sequential walk to find the boundaries.
+	template <typename Map>
+	class StdMapAdapter {
+	public:
+		using map_type = Map;
+		using key_type = typename Map::key_type;
+		using mapped_type = typename Map::mapped_type;
+		using value_type = typename Map::value_type;
+		using size_type = std::size_t;
+		using reference = value_type&;
+		using const_reference = const value_type&;
+		using iterator = typename Map::iterator;
+		using const_iterator = typename Map::const_iterator;
+
+		StdMapAdapter()
+		{}
+
+		StdMapAdapter(std::initializer_list<value_type> list)
+			: map(list)
+		{}
+
+		bool isEmpty() const
+		{
+			return map.empty();
+		}
+
+		mapped_type& operator[](const key_type& key)
+		{
+			return map[key];
+		}
+
+		const mapped_type& valueOf(const key_type& key) const
+		{
+			const_iterator search = map.find(key);
+			if (search == map.end()) {
+				throw std::out_of_range("cannot access non-existent element");
+			}
+			return search->second;
+		}
+
+		mapped_type& valueOf(const key_type& key)
+		{
+			iterator search = map.find(key);
+			if (search == map.end()) {
+				throw std::out_of_range("cannot access non-existent element");
+			}
+			return search->second;
+		}
+
+		const_iterator find(const key_type& key) const
+		{
+			return map.find(key);
+		}
+
+		iterator find(const key_type& key)
+		{
+			return map.find(key);
+		}
+
+		void remove(const key_type& key)
+		{
+			if (isEmpty()) {
+				throw std::out_of_range("cannot remove from empty map");
+			}
+			if (map.erase(key) == 0) {
+				throw std::out_of_range("cannot remove element with non-existent key");
+			}
+		}
+
+		void remove(const const_iterator& it)
+		{
+			if (it == map.end()) {
+				throw std::out_of_range("cannot remove end");
+			}
+			map.erase(it);
+		}
+
+		size_type getSize() const
+		{
+			return map.size();
+		}
+
+		template <typename Function>
+		void parallelForEach(ThreadPool& pool, Function fn)
+		{
+			forEachChunk(pool, [&fn](size_type, reference item) { fn(item); });
+		}
+
+		template <typename Function>
+		void parallelForEach(ThreadPool& pool, Function fn) const
+		{
+			const_cast<StdMapAdapter*>(this)->forEachChunk(pool, [&fn](size_type, const_reference item) { fn(item); });
+		}
+
+		// chunks are combined in iteration order, as in the other maps
+		template <typename Result, typename MapFunction, typename Combine>
+		Result parallelReduce(ThreadPool& pool, Result init, MapFunction map_item, Combine combine) const
+		{
+			std::vector<std::unique_ptr<Result>> partials(PARALLEL_CHUNKS);
+			const_cast<StdMapAdapter*>(this)->forEachChunk(pool,
+				[&partials, &map_item, &combine](size_type chunk, const_reference item) {
+					std::unique_ptr<Result>& partial = partials[chunk];
+					if (partial) {
+						*partial = combine(std::move(*partial), map_item(item));
+					}
+					else {
+						partial.reset(new Result(map_item(item)));
+					}
+				});
+
+			for (auto& partial : partials) {
+				if (partial) {
+					init = combine(std::move(init), std::move(*partial));
+				}
+			}
+			return init;
+		}
+
+		const map_type& getMap() const
+		{
+			return map;
+		}
+
+		bool operator==(const StdMapAdapter& other) const
+		{
+			return map == other.map;
+		}
+
+		bool operator!=(const StdMapAdapter& other) const
+		{
+			return !(*this == other);
+		}
+
+		iterator begin()
+		{
+			return map.begin();
+		}
+
+		iterator end()
+		{
+			return map.end();
+		}
+
+		const_iterator cbegin() const
+		{
+			return map.cbegin();
+		}
+
+		const_iterator cend() const
+		{
+			return map.cend();
+		}
+
+		const_iterator begin() const
+		{
+			return map.begin();
+		}
+
+		const_iterator end() const
+		{
+			return map.end();
+		}
+
+	private:
+		static const size_type PARALLEL_CHUNKS = 64;
+
+		using is_hashed = std::is_same<typename std::iterator_traits<iterator>::iterator_category,
+			std::forward_iterator_tag>;
+
+		map_type map;
+
+		// calls fn(chunk, item) for every element, each chunk on one task of the pool
+		template <typename Function>
+		void forEachChunk(ThreadPool& pool, Function fn)
+		{
+			forEachChunk(pool, fn, is_hashed());
+		}
+
+		template <typename Function>
+		void forEachChunk(ThreadPool& pool, Function& fn, std::true_type)
+		{
+			size_type buckets = map.bucket_count();
+			pool.parallelFor(PARALLEL_CHUNKS, [this, &fn, buckets](size_type chunk) {
+				for (size_type i = buckets * chunk / PARALLEL_CHUNKS; i < buckets * (chunk + 1) / PARALLEL_CHUNKS; ++i) {
+					for (auto it = map.begin(i); it != map.end(i); ++it) {
+						fn(chunk, *it);
+					}
+				}
+			});
+		}
+
+		template <typename Function>
+		void forEachChunk(ThreadPool& pool, Function& fn, std::false_type)
+		{
+			std::vector<iterator> bounds;
+			bounds.reserve(PARALLEL_CHUNKS + 1);
+			iterator it = map.begin();
+			for (size_type chunk = 0, index = 0; chunk < PARALLEL_CHUNKS; ++chunk) {
+				bounds.push_back(it);
+				for (size_type next = map.size() * (chunk + 1) / PARALLEL_CHUNKS; index < next; ++index) {
+					++it;
+				}
+			}
+			bounds.push_back(map.end());
+			pool.parallelFor(PARALLEL_CHUNKS, [&bounds, &fn](size_type chunk) {
+				for (iterator item = bounds[chunk]; item != bounds[chunk + 1]; ++item) {
+					fn(chunk, *item);
+				}
+			});
+		}
+	};
+
+}
+
+#endif /* AISDI_MAPS_STDMAPADAPTER_H */
@@ -0,0 +1,195 @@
+#ifndef AISDI_MAPS_THREADPOOL_H
+#define AISDI_MAPS_THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aisdi
+{
+
+	// Work-stealing pool: every worker owns a deque, takes its own work from the back
+	// and steals from the front of the others when it runs dry.
+	class ThreadPool {
+	public:
+		using size_type = std::size_t;
+
+		explicit ThreadPool(size_type thread_count = std::thread::hardware_concurrency())
+			: queued(0)
+			, stopping(false)
+		{
+			// the calling thread always takes part in parallelFor, so it counts as a worker
+			size_type worker_count = thread_count > 1 ? thread_count - 1 : 0;
+			for (size_type i = 0; i < worker_count; ++i) {
+				queues.emplace_back(new WorkQueue());
+			}
+			for (size_type i = 0; i < worker_count; ++i) {
+				workers.emplace_back([this, i]() { workerLoop(i); });
+			}
+		}
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		~ThreadPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			wakeup.notify_all();
+			for (auto& worker : workers) {
+				worker.join();
+			}
+		}
+
+		size_type getSize() const
+		{
+			return workers.size() + 1;
+		}
+
+		// runs task(i) for every i in [0, count) and blocks until all of them are done;
+		// the first exception thrown by a task is rethrown here
+		template <typename Function>
+		void parallelFor(size_type count, Function task)
+		{
+			if (count == 0) {
+				return;
+			}
+			if (workers.empty() || count == 1) {
+				for (size_type i = 0; i < count; ++i) {
+					task(i);
+				}
+				return;
+			}
+
+			auto batch = std::make_shared<Batch>(count);
+			auto shared_task = std::make_shared<Function>(std::move(task));
+
+			// contiguous blocks per worker keep neighbouring indices together until someone steals
+			queued.fetch_add(count, std::memory_order_release);
+			for (size_type q = 0; q < queues.size(); ++q) {
+				size_type from = count * q / queues.size();
+				size_type to = count * (q + 1) / queues.size();
+				std::lock_guard<std::mutex> lock(queues[q]->mutex);
+				for (size_type i = from; i < to; ++i) {
+					queues[q]->tasks.emplace_back([batch, shared_task, i]() { batch->run(*shared_task, i); });
+				}
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+			}
+			wakeup.notify_all();
+
+			std::function<void()> work;
+			while (batch->remaining.load(std::memory_order_acquire) != 0 && steal(0, work)) {
+				work();
+			}
+
+			std::unique_lock<std::mutex> lock(batch->mutex);
+			batch->done.wait(lock, [&batch]() { return batch->remaining.load() == 0; });
+			if (batch->error) {
+				std::rethrow_exception(batch->error);
+			}
+		}
+
+	private:
+		struct Batch {
+			explicit Batch(size_type count)
+				: remaining(count)
+			{}
+
+			template <typename Function>
+			void run(Function& task, size_type i)
+			{
+				try {
+					task(i);
+				}
+				catch (...) {
+					std::lock_guard<std::mutex> lock(mutex);
+					if (!error) {
+						error = std::current_exception();
+					}
+				}
+				if (--remaining == 0) {
+					std::lock_guard<std::mutex> lock(mutex);
+					done.notify_all();
+				}
+			}
+
+			std::atomic<size_type> remaining;
+			std::mutex mutex;
+			std::condition_variable done;
+			std::exception_ptr error;
+		};
+
+		struct WorkQueue {
+			std::mutex mutex;
+			std::deque<std::function<void()>> tasks;
+		};
+
+		std::vector<std::unique_ptr<WorkQueue>> queues;
+		std::vector<std::thread> workers;
+		std::atomic<size_type> queued;
+		std::mutex mutex;
+		std::condition_variable wakeup;
+		bool stopping;
+
+		bool popOwn(size_type index, std::function<void()>& work)
+		{
+			WorkQueue& queue = *queues[index];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.tasks.empty()) {
+				return false;
+			}
+			work = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+			queued.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		bool steal(size_type start, std::function<void()>& work)
+		{
+			for (size_type k = 0; k < queues.size(); ++k) {
+				WorkQueue& queue = *queues[(start + k) % queues.size()];
+				std::lock_guard<std::mutex> lock(queue.mutex);
+				if (!queue.tasks.empty()) {
+					work = std::move(queue.tasks.front());
+					queue.tasks.pop_front();
+					queued.fetch_sub(1, std::memory_order_relaxed);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void workerLoop(size_type index)
+		{
+			std::function<void()> work;
+			for (;;) {
+				if (popOwn(index, work) || steal(index + 1, work)) {
+					work();
+					work = nullptr;
+					continue;
+				}
+
+				std::unique_lock<std::mutex> lock(mutex);
+				wakeup.wait(lock, [this]() { return stopping || queued.load(std::memory_order_acquire) != 0; });
+				if (stopping && queued.load(std::memory_order_acquire) == 0) {
+					return;
+				}
+			}
+		}
+	};
+
+}
+
+#endif /* AISDI_MAPS_THREADPOOL_H */
@@ -1,15 +1,30 @@
 #ifndef AISDI_MAPS_TREEMAP_H
 #define AISDI_MAPS_TREEMAP_H
 
+#include "MapStats.h"
+#include "ThreadPool.h"
+#include <algorithm>
 #include <cstddef>
+#include <functional>
 #include <initializer_list>
+#include <memory>
 #include <stdexcept>
 #include <utility>
+#include <vector>
 
 namespace aisdi
 {
 
-	template <typename KeyType, typename ValueType>
+	// how a TreeMap reshapes itself on non-const find() and operator[]
+	enum class TreeAccessPolicy {
+		Static,
+		// move the accessed node to the root
+		Splay,
+		// halve the depth of the access path, leaving the node close to the root
+		SemiSplay
+	};
+
+	template <typename KeyType, typename ValueType, typename Compare = std::less<KeyType>>
 	class TreeMap {
 	public:
 		using key_type = KeyType;
@@ -18,6 +33,7 @@ namespace aisdi
 		using size_type = std::size_t;
 		using reference = value_type&;
 		using const_reference = const value_type&;
+		using key_compare = Compare;
 
 		class ConstIterator;
 		class Iterator;
@@ -25,8 +41,16 @@ namespace aisdi
 		using const_iterator = ConstIterator;
 
 		TreeMap()
+			: TreeMap(Compare())
+		{}
+
+		explicit TreeMap(const Compare& comp)
 			: root(nullptr)
+			, first(nullptr)
+			, last(nullptr)
 			, size(0)
+			, comp(comp)
+			, policy(TreeAccessPolicy::Static)
 		{}
 
 		TreeMap(std::initializer_list<value_type> list)
@@ -38,31 +62,45 @@ namespace aisdi
 		}
 
 		TreeMap(const TreeMap& other)
-			: root(nullptr)
-			, size(other.size)
+			: TreeMap(other.comp)
 		{
-			root = copyTreeStructure(nullptr, other.root);
+			policy = other.policy;
+			copyFrom(other);
+		}
+
+		TreeMap(const TreeMap& other, ThreadPool& pool)
+			: TreeMap(other.comp)
+		{
+			policy = other.policy;
+			copyFrom(other, pool);
 		}
 
 		TreeMap(TreeMap&& other)
 			: root(other.root)
+			, first(other.first)
+			, last(other.last)
 			, size(other.size)
+			, comp(other.comp)
+			, policy(other.policy)
 		{
 			other.root = nullptr;
+			other.first = nullptr;
+			other.last = nullptr;
 			other.size = 0;
 		}
 
 		~TreeMap()
 		{
-			clear(root);
+			clear();
 		}
 
 		TreeMap& operator=(const TreeMap& other)
 		{
 			if (this != &other) {
-				clear(root);
-				root = copyTreeStructure(nullptr, other.root);
-				size = other.size;
+				clear();
+				comp = other.comp;
+				policy = other.policy;
+				copyFrom(other);
 			}
 			return *this;
 		}
@@ -70,10 +108,16 @@ namespace aisdi
 		TreeMap& operator=(TreeMap&& other)
 		{
 			if (this != &other) {
-				clear(root);
+				clear();
 				root = other.root;
+				first = other.first;
+				last = other.last;
 				size = other.size;
+				comp = other.comp;
+				policy = other.policy;
 				other.root = nullptr;
+				other.first = nullptr;
+				other.last = nullptr;
 				other.size = 0;
 			}
 			return *this;
@@ -84,9 +128,61 @@ namespace aisdi
 			return !size;
 		}
 
+		void clear()
+		{
+			for (Node* node = first; node != nullptr; ) {
+				Node* next = node->next;
+				delete node;
+				node = next;
+			}
+			root = nullptr;
+			first = nullptr;
+			last = nullptr;
+			size = 0;
+		}
+
+		// tears independent subtrees down on the pool's workers
+		void clear(ThreadPool& pool)
+		{
+			if (size < PARALLEL_THRESHOLD || pool.getSize() == 1) {
+				clear();
+				return;
+			}
+
+			std::vector<Node*> subtrees;
+			std::vector<Node*> top;
+			collectTop(root, splitDepth(pool), subtrees, top);
+			pool.parallelFor(subtrees.size(), [&subtrees](size_type i) {
+				Node* node = leftmost(subtrees[i]);
+				Node* end = rightmost(subtrees[i])->next;
+				while (node != end) {
+					Node* next = node->next;
+					delete node;
+					node = next;
+				}
+			});
+			deleteNodes(top);
+			root = nullptr;
+			first = nullptr;
+			last = nullptr;
+			size = 0;
+		}
+
 		mapped_type& operator[](const key_type& key)
 		{
-			return insert(key, mapped_type())->second;
+			iterator result = insert(key, mapped_type());
+			access(result.node);
+			return result->second;
+		}
+
+		void setAccessPolicy(TreeAccessPolicy access_policy)
+		{
+			policy = access_policy;
+		}
+
+		TreeAccessPolicy getAccessPolicy() const
+		{
+			return policy;
 		}
 
 		const mapped_type& valueOf(const key_type& key) const
@@ -109,46 +205,41 @@ namespace aisdi
 
 		const_iterator find(const key_type& key) const
 		{
-			Node* temp = root;
-
-			for (;;) {
-				if (temp == nullptr) {
-					return cend();
-				}
-
-				if (temp->data.first == key) {
-					return const_iterator(*this, temp);
-				}
+			return const_iterator(*this, findNode(key));
+		}
 
-				if (key > temp->data.first) {
-					temp = temp->right;
-				}
-				else {
-					temp = temp->left;
-				}
+		iterator find(const key_type& key)
+		{
+			Node* node = findNode(key);
+			if (node != nullptr) {
+				access(node);
 			}
+			return iterator(*this, node);
 		}
 
-		iterator find(const key_type& key)
+		const_iterator lowerBound(const key_type& key) const
 		{
-			Node* temp = root;
+			return const_iterator(*this, lowerBoundNode(key));
+		}
 
-			for (;;) {
-				if (temp == nullptr) {
-					return end();
-				}
+		iterator lowerBound(const key_type& key)
+		{
+			return iterator(*this, lowerBoundNode(key));
+		}
 
-				if (temp->data.first == key) {
-					return iterator(*this, temp);
-				}
+		const_iterator upperBound(const key_type& key) const
+		{
+			return const_iterator(*this, upperBoundNode(key));
+		}
 
-				if (key > temp->data.first) {
-					temp = temp->right;
-				}
-				else {
-					temp = temp->left;
-				}
-			}
+		iterator upperBound(const key_type& key)
+		{
+			return iterator(*this, upperBoundNode(key));
+		}
+
+		key_compare keyComp() const
+		{
+			return comp;
 		}
 
 		void remove(const key_type& key)
@@ -168,6 +259,7 @@ namespace aisdi
 
 			erase(it.node);
 			--size;
+			counters.removal();
 		}
 
 		size_type getSize() const
@@ -175,6 +267,191 @@ namespace aisdi
 			return size;
 		}
 
+		// bytes held by the nodes, not counting allocator overhead or memory the elements own themselves
+		size_type getMemoryUsage() const
+		{
+			return size * sizeof(Node);
+		}
+
+		// one post-order walk with an explicit stack, so that a degenerate tree does not overflow
+		// the call stack
+		TreeMapStats stats() const
+		{
+			// stage 0: node not entered yet, 1: left subtree done, 2: both subtrees done
+			struct Frame {
+				const Node* node;
+				size_type left_height;
+				int stage;
+			};
+
+			TreeMapStats result = TreeMapStats();
+			result.size = size;
+			result.operations = counters.get();
+			std::vector<Frame> stack;
+			if (root != nullptr) {
+				stack.push_back(Frame{ root, 0, 0 });
+			}
+			// height of the subtree finished last
+			size_type finished = 0;
+			double depth_sum = 0;
+			while (!stack.empty()) {
+				Frame& frame = stack.back();
+				const Node* node = frame.node;
+				if (frame.stage == 0) {
+					depth_sum += stack.size() - 1;
+					frame.stage = 1;
+					finished = 0;
+					if (node->left != nullptr) {
+						stack.push_back(Frame{ node->left, 0, 0 });
+						continue;
+					}
+				}
+				if (frame.stage == 1) {
+					frame.left_height = finished;
+					frame.stage = 2;
+					finished = 0;
+					if (node->right != nullptr) {
+						stack.push_back(Frame{ node->right, 0, 0 });
+						continue;
+					}
+				}
+				std::ptrdiff_t balance = static_cast<std::ptrdiff_t>(finished) - static_cast<std::ptrdiff_t>(frame.left_height);
+				++result.balance_factors[balance];
+				finished = std::max(finished, frame.left_height) + 1;
+				stack.pop_back();
+			}
+			result.height = finished;
+			result.average_depth = size != 0 ? depth_sum / size : 0;
+			return result;
+		}
+
+		void resetCounters()
+		{
+			counters.reset();
+		}
+
+		// builds a perfectly balanced tree in O(n) from a range strictly ascending by key
+		template <typename InputIt>
+		static TreeMap fromSorted(InputIt from, InputIt to, const Compare& comp = Compare())
+		{
+			TreeMap result(comp);
+			std::vector<Node*> nodes;
+			try {
+				for (; from != to; ++from) {
+					if (!nodes.empty() && !comp(nodes.back()->data.first, from->first)) {
+						throw std::invalid_argument("range is not strictly ascending by key");
+					}
+					nodes.push_back(new Node(*from));
+				}
+			}
+			catch (...) {
+				deleteNodes(nodes);
+				throw;
+			}
+			result.assemble(nodes);
+			return result;
+		}
+
+		// moves elements with keys absent from this map out of other, leaving duplicates in other
+		void merge(TreeMap& other)
+		{
+			if (this == &other) {
+				return;
+			}
+
+			std::vector<Node*> kept;
+			std::vector<Node*> left_over;
+			kept.reserve(size + other.size);
+			Node* a = first;
+			Node* b = other.first;
+			while (a != nullptr || b != nullptr) {
+				if (b == nullptr || (a != nullptr && comp(a->data.first, b->data.first))) {
+					kept.push_back(a);
+					a = a->next;
+				}
+				else if (a == nullptr || comp(b->data.first, a->data.first)) {
+					kept.push_back(b);
+					b = b->next;
+				}
+				else {
+					kept.push_back(a);
+					left_over.push_back(b);
+					a = a->next;
+					b = b->next;
+				}
+			}
+			assemble(kept);
+			other.assemble(left_over);
+		}
+
+		void merge(TreeMap&& other)
+		{
+			merge(other);
+		}
+
+		// values of keys present in both maps are taken from this map
+		TreeMap unionWith(const TreeMap& other) const
+		{
+			return combine(other, true, true, true);
+		}
+
+		TreeMap intersection(const TreeMap& other) const
+		{
+			return combine(other, false, true, false);
+		}
+
+		TreeMap difference(const TreeMap& other) const
+		{
+			return combine(other, true, false, false);
+		}
+
+		// calls fn on every element; the tree is cut into in-order chunks at PARALLEL_DEPTH
+		template <typename Function>
+		void parallelForEach(ThreadPool& pool, Function fn)
+		{
+			std::vector<Node*> starts = chunkStarts();
+			pool.parallelFor(starts.size(), [&starts, &fn](size_type chunk) {
+				Node* end = chunk + 1 < starts.size() ? starts[chunk + 1] : nullptr;
+				for (Node* node = starts[chunk]; node != end; node = node->next) {
+					fn(node->data);
+				}
+			});
+		}
+
+		template <typename Function>
+		void parallelForEach(ThreadPool& pool, Function fn) const
+		{
+			std::vector<Node*> starts = chunkStarts();
+			pool.parallelFor(starts.size(), [&starts, &fn](size_type chunk) {
+				Node* end = chunk + 1 < starts.size() ? starts[chunk + 1] : nullptr;
+				for (const Node* node = starts[chunk]; node != end; node = node->next) {
+					fn(node->data);
+				}
+			});
+		}
+
+		// folds map(element) with an associative combine; chunks are combined in key order,
+		// so the result does not depend on the pool size or scheduling
+		template <typename Result, typename Map, typename Combine>
+		Result parallelReduce(ThreadPool& pool, Result init, Map map, Combine combine) const
+		{
+			std::vector<Node*> starts = chunkStarts();
+			std::vector<std::unique_ptr<Result>> partials(starts.size());
+			pool.parallelFor(starts.size(), [&starts, &partials, &map, &combine](size_type chunk) {
+				Node* end = chunk + 1 < starts.size() ? starts[chunk + 1] : nullptr;
+				std::unique_ptr<Result> partial(new Result(map(static_cast<const_reference>(starts[chunk]->data))));
+				for (const Node* node = starts[chunk]->next; node != end; node = node->next) {
+					*partial = combine(std::move(*partial), map(static_cast<const_reference>(node->data)));
+				}
+				partials[chunk] = std::move(partial);
+			});
+
+			for (auto& partial : partials) {
+				init = combine(std::move(init), std::move(*partial));
+			}
+			return init;
+		}
+
 		bool operator==(const TreeMap& other) const
 		{
 			if (size != other.size) {
@@ -198,15 +475,7 @@ namespace aisdi
 
 		iterator begin()
 		{
-			if (root == nullptr) {
-				return end();
-			}
-
-			Node* temp = root;
-			while (temp->left != nullptr) {
-				temp = temp->left;
-			}
-			return iterator(*this, temp);
+			return iterator(*this, first);
 		}
 
 		iterator end()
@@ -216,15 +485,7 @@ namespace aisdi
 
 		const_iterator cbegin() const
 		{
-			if (root == nullptr) {
-				return cend();
-			}
-
-			Node* temp = root;
-			while (temp->left != nullptr) {
-				temp = temp->left;
-			}
-			return const_iterator(*this, temp);
+			return const_iterator(*this, first);
 		}
 
 		const_iterator cend() const
@@ -249,142 +510,560 @@ namespace aisdi
 			Node* parent;
 			Node* left;
 			Node* right;
+			// in-order neighbours, so iterators never have to climb the tree
+			Node* prev;
+			Node* next;
 
 			Node(value_type data, Node* parent = nullptr, Node* left = nullptr, Node* right = nullptr)
 				: data(data)
 				, parent(parent)
 				, left(left)
 				, right(right)
+				, prev(nullptr)
+				, next(nullptr)
 			{}
 
 		};
 
 		Node* root;
+		Node* first;
+		Node* last;
 		size_type size;
+		Compare comp;
+		TreeAccessPolicy policy;
+		OperationCounters counters;
+
+		void access(Node* node)
+		{
+			switch (policy) {
+			case TreeAccessPolicy::Static:
+				break;
+			case TreeAccessPolicy::Splay:
+				splay(node);
+				break;
+			case TreeAccessPolicy::SemiSplay:
+				semiSplay(node);
+				break;
+			}
+		}
+
+		// lifts node above its parent; in-order threads are unaffected
+		void rotateUp(Node* node)
+		{
+			Node* parent = node->parent;
+			Node* grandparent = parent->parent;
+			if (node == parent->left) {
+				parent->left = node->right;
+				if (node->right != nullptr) {
+					node->right->parent = parent;
+				}
+				node->right = parent;
+			}
+			else {
+				parent->right = node->left;
+				if (node->left != nullptr) {
+					node->left->parent = parent;
+				}
+				node->left = parent;
+			}
+			parent->parent = node;
+			node->parent = grandparent;
+			if (grandparent == nullptr) {
+				root = node;
+			}
+			else if (grandparent->left == parent) {
+				grandparent->left = node;
+			}
+			else {
+				grandparent->right = node;
+			}
+		}
+
+		void splay(Node* node)
+		{
+			while (node->parent != nullptr) {
+				Node* parent = node->parent;
+				Node* grandparent = parent->parent;
+				if (grandparent == nullptr) {
+					rotateUp(node);
+				}
+				else if ((grandparent->left == parent) == (parent->left == node)) {
+					rotateUp(parent);
+					rotateUp(node);
+				}
+				else {
+					rotateUp(node);
+					rotateUp(node);
+				}
+			}
+		}
+
+		// zig-zig steps rotate only the parent and carry on from there (Sleator-Tarjan semi-splaying)
+		void semiSplay(Node* node)
+		{
+			while (node->parent != nullptr && node->parent->parent != nullptr) {
+				Node* parent = node->parent;
+				Node* grandparent = parent->parent;
+				if ((grandparent->left == parent) == (parent->left == node)) {
+					rotateUp(parent);
+					node = parent;
+				}
+				else {
+					rotateUp(node);
+					rotateUp(node);
+				}
+			}
+		}
+
+		// comp for the searches, counted when AISDI_MAP_COUNTERS is defined
+		bool less(const key_type& a, const key_type& b) const
+		{
+			counters.comparison();
+			return comp(a, b);
+		}
+
+		// one comparison per level: descend to the first node not less than key
+		Node* lowerBoundNode(const key_type& key) const
+		{
+			counters.lookup();
+			Node* candidate = nullptr;
+			for (Node* temp = root; temp != nullptr; ) {
+				if (less(temp->data.first, key)) {
+					temp = temp->right;
+				}
+				else {
+					candidate = temp;
+					temp = temp->left;
+				}
+			}
+			return candidate;
+		}
+
+		Node* upperBoundNode(const key_type& key) const
+		{
+			counters.lookup();
+			Node* candidate = nullptr;
+			for (Node* temp = root; temp != nullptr; ) {
+				if (less(key, temp->data.first)) {
+					candidate = temp;
+					temp = temp->left;
+				}
+				else {
+					temp = temp->right;
+				}
+			}
+			return candidate;
+		}
+
+		Node* findNode(const key_type& key) const
+		{
+			Node* candidate = lowerBoundNode(key);
+			if (candidate != nullptr && !less(key, candidate->data.first)) {
+				return candidate;
+			}
+			return nullptr;
+		}
+
+		static const size_type PARALLEL_THRESHOLD = 1 << 15;
+		static const size_type PARALLEL_DEPTH = 6;
+
+		struct Subtree {
+			const Node* source;
+			Node* parent;
+			Node** slot;
+		};
+
+		static Node* leftmost(Node* node)
+		{
+			while (node->left != nullptr) {
+				node = node->left;
+			}
+			return node;
+		}
+
+		static Node* rightmost(Node* node)
+		{
+			while (node->right != nullptr) {
+				node = node->right;
+			}
+			return node;
+		}
+
+		// roughly eight subtrees per worker, so uneven subtrees still balance out
+		static size_type splitDepth(const ThreadPool& pool)
+		{
+			size_type depth = 3;
+			while ((size_type(1) << depth) < pool.getSize() * 8) {
+				++depth;
+			}
+			return depth;
+		}
+
+		// first node of every chunk, in key order; nodes above PARALLEL_DEPTH join the chunk to their left
+		std::vector<Node*> chunkStarts() const
+		{
+			std::vector<Node*> starts;
+			if (first != nullptr) {
+				starts.push_back(first);
+				collectChunkStarts(root, PARALLEL_DEPTH, starts);
+			}
+			return starts;
+		}
 
-		void clear(Node* node)
+		static void collectChunkStarts(Node* node, size_type depth, std::vector<Node*>& starts)
 		{
 			if (node == nullptr) {
 				return;
 			}
-			clear(node->left);
-			clear(node->right);
-			delete node;
+			if (depth == 0) {
+				Node* start = leftmost(node);
+				if (start != starts.back()) {
+					starts.push_back(start);
+				}
+				return;
+			}
+			collectChunkStarts(node->left, depth - 1, starts);
+			collectChunkStarts(node->right, depth - 1, starts);
 		}
 
-		Node* copyTreeStructure(Node* parent, Node* other_node)
+		static void collectTop(Node* node, size_type depth, std::vector<Node*>& subtrees, std::vector<Node*>& top)
 		{
-			if (other_node == nullptr) {
-				return nullptr;
+			if (node == nullptr) {
+				return;
+			}
+			if (depth == 0) {
+				subtrees.push_back(node);
+				return;
 			}
-			Node* to_add = new Node(other_node->data, parent);
-			to_add->left = copyTreeStructure(to_add, other_node->left);
-			to_add->right = copyTreeStructure(to_add, other_node->right);
-			return to_add;
+			top.push_back(node);
+			collectTop(node->left, depth - 1, subtrees, top);
+			collectTop(node->right, depth - 1, subtrees, top);
 		}
 
-		iterator insert(const key_type& key, const mapped_type& value)
+		static void deleteNodes(const std::vector<Node*>& nodes)
 		{
-			iterator search = find(key);
-			if (search != end()) {
-				return search;
+			for (Node* node : nodes) {
+				delete node;
 			}
+		}
 
-			Node* to_add = new Node(std::make_pair(key, value));
-			++size;
+		static Node* buildBalanced(Node* const* nodes, size_type count, Node* parent)
+		{
+			if (count == 0) {
+				return nullptr;
+			}
+			size_type middle = count / 2;
+			Node* node = nodes[middle];
+			node->parent = parent;
+			node->left = buildBalanced(nodes, middle, node);
+			node->right = buildBalanced(nodes + middle + 1, count - middle - 1, node);
+			return node;
+		}
 
-			if (root == nullptr) {
-				root = to_add;
-				return iterator(*this, to_add);
-			}
-
-			for (Node* iter = root; ; ) {
-				if (key < iter->data.first) {
-					if (iter->left == nullptr) {
-						iter->left = to_add;
-						to_add->parent = iter;
-						return iterator(*this, to_add);
-					}
-					else {
-						iter = iter->left;
-					}
-				}
-				else {
-					if (iter->right == nullptr) {
-						iter->right = to_add;
-						to_add->parent = iter;
-						return iterator(*this, to_add);
-					}
-					else {
-						iter = iter->right;
-					}
-				}
+		// replaces the tree structure with a balanced one over nodes, which must be in key order
+		void assemble(const std::vector<Node*>& nodes)
+		{
+			root = buildBalanced(nodes.data(), nodes.size(), nullptr);
+			Node* previous = nullptr;
+			for (Node* node : nodes) {
+				node->prev = previous;
+				node->next = nullptr;
+				if (previous != nullptr) {
+					previous->next = node;
+				}
+				previous = node;
 			}
+			first = nodes.empty() ? nullptr : nodes.front();
+			last = previous;
+			size = nodes.size();
 		}
 
-		void erase(Node* node)
+		// single in-order walk over both maps, copying the keys selected by the flags
+		TreeMap combine(const TreeMap& other, bool only_this, bool both, bool only_other) const
 		{
-			//no children
-			if (node->left == nullptr && node->right == nullptr) {
-				if (node->parent != nullptr) {
-					if (node == node->parent->left) {
-						node->parent->left = nullptr;
+			std::vector<Node*> nodes;
+			const Node* a = first;
+			const Node* b = other.first;
+			try {
+				while (a != nullptr || b != nullptr) {
+					if (b == nullptr || (a != nullptr && comp(a->data.first, b->data.first))) {
+						if (only_this) {
+							nodes.push_back(new Node(a->data));
+						}
+						else if (b == nullptr) {
+							break;
+						}
+						a = a->next;
+					}
+					else if (a == nullptr || comp(b->data.first, a->data.first)) {
+						if (only_other) {
+							nodes.push_back(new Node(b->data));
+						}
+						else if (a == nullptr) {
+							break;
+						}
+						b = b->next;
 					}
 					else {
-						node->parent->right = nullptr;
+						if (both) {
+							nodes.push_back(new Node(a->data));
+						}
+						a = a->next;
+						b = b->next;
 					}
 				}
+			}
+			catch (...) {
+				deleteNodes(nodes);
+				throw;
+			}
+			TreeMap result(comp);
+			result.assemble(nodes);
+			return result;
+		}
+
+		void copyFrom(const TreeMap& other)
+		{
+			root = cloneStructure(other.root, nullptr);
+			Node* previous = nullptr;
+			linkThreads(root, previous);
+			first = root != nullptr ? leftmost(root) : nullptr;
+			last = previous;
+			size = other.size;
+		}
+
+		void copyFrom(const TreeMap& other, ThreadPool& pool)
+		{
+			if (other.size < PARALLEL_THRESHOLD || pool.getSize() == 1) {
+				copyFrom(other);
+				return;
+			}
+
+			std::vector<Subtree> subtrees;
+			size_type depth = splitDepth(pool);
+			cloneTop(other.root, nullptr, root, depth, subtrees);
+			pool.parallelFor(subtrees.size(), [&subtrees](size_type i) {
+				Node* copy = cloneStructure(subtrees[i].source, subtrees[i].parent);
+				Node* previous = nullptr;
+				linkThreads(copy, previous);
+				*subtrees[i].slot = copy;
+			});
+
+			Node* previous = nullptr;
+			linkTop(root, depth, previous);
+			first = leftmost(root);
+			last = previous;
+			size = other.size;
+		}
+
+		// copies the shape of source without recursion by walking both trees in lockstep
+		static Node* cloneStructure(const Node* source, Node* parent)
+		{
+			if (source == nullptr) {
+				return nullptr;
+			}
+			Node* copy = new Node(source->data, parent);
+			const Node* from = source;
+			Node* to = copy;
+			for (;;) {
+				if (from->left != nullptr && to->left == nullptr) {
+					to->left = new Node(from->left->data, to);
+					from = from->left;
+					to = to->left;
+				}
+				else if (from->right != nullptr && to->right == nullptr) {
+					to->right = new Node(from->right->data, to);
+					from = from->right;
+					to = to->right;
+				}
+				else if (from == source) {
+					return copy;
+				}
 				else {
-					root = nullptr;
+					from = from->parent;
+					to = to->parent;
 				}
-				delete node;
+			}
+		}
+
+		// threads subtree in order after previous, iteratively
+		static void linkThreads(Node* subtree, Node*& previous)
+		{
+			if (subtree == nullptr) {
 				return;
 			}
+			Node* node = leftmost(subtree);
+			while (node != nullptr) {
+				node->prev = previous;
+				if (previous != nullptr) {
+					previous->next = node;
+				}
+				previous = node;
 
-			//one child
-			if (node->left != nullptr || node->right != nullptr) {
-				Node* child = node->left ? node->left : node->right;
-				if (node->parent != nullptr) {
-					if (node == node->parent->left) {
-						node->parent->left = child;
-					}
-					else {
-						node->parent->right = child;
-					}
+				if (node->right != nullptr) {
+					node = leftmost(node->right);
 				}
 				else {
-					root = child;
+					while (node != subtree && node == node->parent->right) {
+						node = node->parent;
+					}
+					node = node != subtree ? node->parent : nullptr;
 				}
-				child->parent = node->parent;
-				delete node;
+			}
+		}
+
+		// copies the top levels and leaves the subtrees below depth for the workers
+		static void cloneTop(const Node* source, Node* parent, Node*& slot, size_type depth, std::vector<Subtree>& subtrees)
+		{
+			slot = nullptr;
+			if (source == nullptr) {
 				return;
 			}
+			if (depth == 0) {
+				subtrees.push_back(Subtree{ source, parent, &slot });
+				return;
+			}
+			slot = new Node(source->data, parent);
+			cloneTop(source->left, slot, slot->left, depth - 1, subtrees);
+			cloneTop(source->right, slot, slot->right, depth - 1, subtrees);
+		}
 
+		static void linkTop(Node* node, size_type depth, Node*& previous)
+		{
+			if (node == nullptr) {
+				return;
+			}
+			if (depth == 0) {
+				//subtree already threaded internally by its worker
+				Node* low = leftmost(node);
+				low->prev = previous;
+				if (previous != nullptr) {
+					previous->next = low;
+				}
+				previous = rightmost(node);
+				return;
+			}
+			linkTop(node->left, depth - 1, previous);
+			node->prev = previous;
+			if (previous != nullptr) {
+				previous->next = node;
+			}
+			previous = node;
+			linkTop(node->right, depth - 1, previous);
+		}
+
+		iterator insert(const key_type& key, const mapped_type& value)
+		{
+			// single descent; candidate ends up as the last node not greater than key
+			counters.lookup();
+			Node* parent = nullptr;
+			Node* candidate = nullptr;
+			bool left = false;
+			for (Node* iter = root; iter != nullptr; ) {
+				parent = iter;
+				left = less(key, iter->data.first);
+				if (left) {
+					iter = iter->left;
+				}
+				else {
+					candidate = iter;
+					iter = iter->right;
+				}
+			}
+
+			if (candidate != nullptr && !less(candidate->data.first, key)) {
+				return iterator(*this, candidate);
+			}
+
+			Node* to_add = new Node(std::make_pair(key, value), parent);
+			++size;
+			counters.insertion();
 
-			//left and right children
-			Node* min = node->right;
-			while (min->left != nullptr) {
-				min = min->left;
+			if (parent == nullptr) {
+				root = to_add;
+				first = to_add;
+				last = to_add;
 			}
-			Node* holder = new Node(std::make_pair(min->data.first, min->data.second), node->parent, node->left, node->right);
-			if (node->parent != nullptr) {
-				if (node == node->parent->left) {
-					node->parent->left = holder;
+			else if (left) {
+				parent->left = to_add;
+				to_add->next = parent;
+				to_add->prev = parent->prev;
+				if (parent->prev != nullptr) {
+					parent->prev->next = to_add;
 				}
 				else {
-					node->parent->right = holder;
+					first = to_add;
 				}
+				parent->prev = to_add;
 			}
 			else {
-				root = holder;
+				parent->right = to_add;
+				to_add->prev = parent;
+				to_add->next = parent->next;
+				if (parent->next != nullptr) {
+					parent->next->prev = to_add;
+				}
+				else {
+					last = to_add;
+				}
+				parent->next = to_add;
+			}
+			return iterator(*this, to_add);
+		}
+
+		void erase(Node* node)
+		{
+			if (node->left != nullptr && node->right != nullptr) {
+				//left and right children - relink the successor into node's place
+				Node* successor = node->next;
+				if (successor != node->right) {
+					replaceInParent(successor, successor->right);
+					successor->right = node->right;
+					successor->right->parent = successor;
+				}
+				replaceInParent(node, successor);
+				successor->left = node->left;
+				successor->left->parent = successor;
+			}
+			else {
+				//at most one child
+				replaceInParent(node, node->left != nullptr ? node->left : node->right);
+			}
+
+			if (node->prev != nullptr) {
+				node->prev->next = node->next;
+			}
+			else {
+				first = node->next;
+			}
+			if (node->next != nullptr) {
+				node->next->prev = node->prev;
+			}
+			else {
+				last = node->prev;
 			}
 			delete node;
-			erase(min);
+		}
+
+		void replaceInParent(Node* node, Node* child)
+		{
+			if (node->parent == nullptr) {
+				root = child;
+			}
+			else if (node == node->parent->left) {
+				node->parent->left = child;
+			}
+			else {
+				node->parent->right = child;
+			}
+			if (child != nullptr) {
+				child->parent = node->parent;
+			}
 		}
 	};
 
-	template <typename KeyType, typename ValueType>
-	class TreeMap<KeyType, ValueType>::ConstIterator {
+	template <typename KeyType, typename ValueType, typename Compare>
+	class TreeMap<KeyType, ValueType, Compare>::ConstIterator {
 	public:
 		using reference = typename TreeMap::const_reference;
 		using iterator_category = std::bidirectional_iterator_tag;
@@ -409,63 +1088,31 @@ namespace aisdi
 				throw std::out_of_range("cannot increment end() iterator");
 			}
 
-			if (node->right != nullptr) {
-				node = node->right;
-				while (node->left != nullptr) {
-					node = node->left;
-				}
-				return *this;
-			}
-
-			key_type key = node->data.first;
-			node = node->parent;
-			while (node != nullptr && node->data.first < key) {
-				node = node->parent;
-			}
+			node = node->next;
 			return *this;
 		}
 
 		ConstIterator operator++(int)
 		{
-			ConstIterator copy = *this;
-			++(*this);
+			ConstIterator copy = *this;
+			++(*this);
 			return copy;
 		}
 
 		ConstIterator& operator--()
 		{
-			if (*this == parent.begin()) {
+			if (node == parent.first) {
 				throw std::out_of_range("cannot decrement begin() iterator");
 			}
 
-			if (node == nullptr) {
-				node = parent.root;
-				while (node->right != nullptr) {
-					node = node->right;
-				}
-				return *this;
-			}
-
-			if (node->left != nullptr) {
-				node = node->left;
-				while (node->right != nullptr) {
-					node = node->right;
-				}
-				return *this;
-			}
-
-			key_type key = node->data.first;
-			node = node->parent;
-			while (node != nullptr && node->data.first > key) {
-				node = node->parent;
-			}
+			node = node == nullptr ? parent.last : node->prev;
 			return *this;
 		}
 
 		ConstIterator operator--(int)
 		{
-			ConstIterator copy = *this;
-			--(*this);
+			ConstIterator copy = *this;
+			--(*this);
 			return copy;
 		}
 
@@ -498,8 +1145,8 @@ namespace aisdi
 		Node* node;
 	};
 
-	template <typename KeyType, typename ValueType>
-	class TreeMap<KeyType, ValueType>::Iterator : public TreeMap<KeyType, ValueType>::ConstIterator {
+	template <typename KeyType, typename ValueType, typename Compare>
+	class TreeMap<KeyType, ValueType, Compare>::Iterator : public TreeMap<KeyType, ValueType, Compare>::ConstIterator {
 	public:
 		using reference = typename TreeMap::reference;
 		using pointer = typename TreeMap::value_type*;
@@ -0,0 +1,585 @@
+#ifndef AISDI_LINEAR_UNROLLEDLINKEDLIST_H
+#define AISDI_LINEAR_UNROLLEDLINKEDLIST_H
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace aisdi
+{
+	// LinkedList with the same interface that stores a chunk of elements per node, so iteration
+	// walks contiguous memory and pays one pointer chase per chunk instead of per element.
+	// A full chunk is split in half on insert, and a chunk is merged into its neighbour once both
+	// fit into one. Inserting or erasing invalidates iterators into the affected chunks.
+	template <typename Type>
+	class UnrolledLinkedList {
+	public:
+		using difference_type = std::ptrdiff_t;
+		using size_type = std::size_t;
+		using value_type = Type;
+		using pointer = Type*;
+		using reference = Type&;
+		using const_pointer = const Type*;
+		using const_reference = const Type&;
+
+		class ConstIterator;
+		class Iterator;
+		using iterator = Iterator;
+		using const_iterator = ConstIterator;
+
+		UnrolledLinkedList()
+			: root(nullptr)
+			, tail(nullptr)
+			, size(0)
+		{}
+
+		UnrolledLinkedList(std::initializer_list<Type> l)
+			: UnrolledLinkedList()
+		{
+			for (const auto& it : l) {
+				append(it);
+			}
+		}
+
+		UnrolledLinkedList(const UnrolledLinkedList& other)
+			: UnrolledLinkedList()
+		{
+			for (const auto& it : other) {
+				append(it);
+			}
+		}
+
+		UnrolledLinkedList(UnrolledLinkedList&& other)
+			: root(other.root)
+			, tail(other.tail)
+			, size(other.size)
+		{
+			other.root = nullptr;
+			other.tail = nullptr;
+			other.size = 0;
+		}
+
+		~UnrolledLinkedList()
+		{
+			clear();
+		}
+
+		UnrolledLinkedList& operator=(const UnrolledLinkedList& other)
+		{
+			if (this != &other) {
+				clear();
+				for (const auto& it : other) {
+					append(it);
+				}
+			}
+			return *this;
+		}
+
+		UnrolledLinkedList& operator=(UnrolledLinkedList&& other)
+		{
+			if (this != &other) {
+				clear();
+				root = other.root;
+				tail = other.tail;
+				size = other.size;
+				other.root = nullptr;
+				other.tail = nullptr;
+				other.size = 0;
+			}
+			return *this;
+		}
+
+		bool isEmpty() const
+		{
+			return !size;
+		}
+
+		size_type getSize() const
+		{
+			return size;
+		}
+
+		void append(const Type& item)
+		{
+			insert(end(), item);
+		}
+
+		void prepend(const Type& item)
+		{
+			insert(begin(), item);
+		}
+
+		void insert(const const_iterator& insertPosition, const Type& item)
+		{
+			// the item may live in the chunk that is about to be shifted
+			Type copy(item);
+			Node* node = insertPosition.ptr;
+			size_type index = insertPosition.index;
+
+			if (node == nullptr) {
+				// appending fills the last chunk and then starts a new one rather than splitting
+				if (tail == nullptr || tail->count == CAPACITY) {
+					linkAfter(tail, new Node());
+				}
+				node = tail;
+				index = tail->count;
+			}
+			else if (index == 0 && node->prev != nullptr && node->prev->count < CAPACITY) {
+				node = node->prev;
+				index = node->count;
+			}
+			else if (node->count == CAPACITY) {
+				Node* half = new Node();
+				linkAfter(node, half);
+				node->moveTo(*half, CAPACITY / 2);
+				if (index > CAPACITY / 2) {
+					node = half;
+					index -= CAPACITY / 2;
+				}
+			}
+			node->insertAt(index, std::move(copy));
+			++size;
+		}
+
+		Type popFirst()
+		{
+			if (isEmpty()) {
+				throw std::logic_error("popping first from empty collection");
+			}
+			Type copy = std::move(root->at(0));
+			erase(begin());
+			return copy;
+		}
+
+		Type popLast()
+		{
+			if (isEmpty()) {
+				throw std::logic_error("popping last from empty collection");
+			}
+			Type copy = std::move(tail->at(tail->count - 1));
+			erase(--end());
+			return copy;
+		}
+
+		void erase(const const_iterator& possition)
+		{
+			if (isEmpty()) {
+				throw std::out_of_range("erasing element from empty collection");
+			}
+			if (possition.ptr == nullptr) {
+				throw std::out_of_range("erasing end() iterator");
+			}
+			Node* node = possition.ptr;
+			node->eraseRange(possition.index, possition.index + 1);
+			--size;
+			if (node->count == 0) {
+				unlinkAndDelete(node);
+			}
+			else if (!mergeWithNext(node->prev)) {
+				mergeWithNext(node);
+			}
+		}
+
+		// whole chunks inside the range are freed without shifting anything
+		void erase(const const_iterator& firstIncluded, const const_iterator& lastExcluded)
+		{
+			Node* node = firstIncluded.ptr;
+			size_type index = firstIncluded.index;
+			while (node != lastExcluded.ptr) {
+				if (node == nullptr) {
+					throw std::out_of_range("erasing past end() iterator");
+				}
+				Node* next = node->next;
+				size -= node->count - index;
+				node->eraseRange(index, node->count);
+				if (node->count == 0) {
+					unlinkAndDelete(node);
+				}
+				node = next;
+				index = 0;
+			}
+			if (node != nullptr && index < lastExcluded.index) {
+				size -= lastExcluded.index - index;
+				node->eraseRange(index, lastExcluded.index);
+			}
+			mergeWithNext(node != nullptr ? node->prev : tail);
+		}
+
+		iterator begin()
+		{
+			return iterator(*this, root, 0);
+		}
+
+		iterator end()
+		{
+			return iterator(*this, nullptr, 0);
+		}
+
+		const_iterator cbegin() const
+		{
+			return const_iterator(*this, root, 0);
+		}
+
+		const_iterator cend() const
+		{
+			return const_iterator(*this, nullptr, 0);
+		}
+
+		const_iterator begin() const
+		{
+			return cbegin();
+		}
+
+		const_iterator end() const
+		{
+			return cend();
+		}
+
+	private:
+		class Node;
+
+		// a chunk with its links and count spans about four cache lines
+		static const size_type CHUNK_BYTES = 256;
+		static const size_type CAPACITY = (CHUNK_BYTES - 3 * sizeof(void*)) / sizeof(Type) < 4
+			? 4 : (CHUNK_BYTES - 3 * sizeof(void*)) / sizeof(Type);
+
+		Node* root;
+		Node* tail;
+		size_type size;
+
+		void linkAfter(Node* position, Node* node)
+		{
+			node->prev = position;
+			node->next = position != nullptr ? position->next : root;
+			if (node->next != nullptr) {
+				node->next->prev = node;
+			}
+			else {
+				tail = node;
+			}
+			if (position != nullptr) {
+				position->next = node;
+			}
+			else {
+				root = node;
+			}
+		}
+
+		void unlinkAndDelete(Node* node)
+		{
+			if (node->prev != nullptr) {
+				node->prev->next = node->next;
+			}
+			else {
+				root = node->next;
+			}
+			if (node->next != nullptr) {
+				node->next->prev = node->prev;
+			}
+			else {
+				tail = node->prev;
+			}
+			delete node;
+		}
+
+		// keeps the chunks on average at least half full
+		bool mergeWithNext(Node* node)
+		{
+			if (node == nullptr || node->next == nullptr || node->count + node->next->count > CAPACITY) {
+				return false;
+			}
+			node->next->moveTo(*node, 0);
+			unlinkAndDelete(node->next);
+			return true;
+		}
+
+		void clear()
+		{
+			size = 0;
+			Node* temp;
+			while (root != nullptr) {
+				temp = root->next;
+				delete root;
+				root = temp;
+			}
+			tail = nullptr;
+		}
+	};
+
+	template <typename Type>
+	class UnrolledLinkedList<Type>::Node {
+	public:
+		Node* next;
+		Node* prev;
+		size_type count;
+
+		Node()
+			: next(nullptr)
+			, prev(nullptr)
+			, count(0)
+		{}
+
+		Node(const Node&) = delete;
+		Node& operator=(const Node&) = delete;
+
+		~Node()
+		{
+			for (size_type i = 0; i < count; ++i) {
+				at(i).~Type();
+			}
+		}
+
+		Type& at(size_type index)
+		{
+			return *slot(index);
+		}
+
+		const Type& at(size_type index) const
+		{
+			return *reinterpret_cast<const Type*>(&elements[index]);
+		}
+
+		void insertAt(size_type index, Type&& item)
+		{
+			if (index == count) {
+				new (slot(count)) Type(std::move(item));
+			}
+			else {
+				new (slot(count)) Type(std::move(at(count - 1)));
+				std::move_backward(slot(index), slot(count - 1), slot(count));
+				at(index) = std::move(item);
+			}
+			++count;
+		}
+
+		void eraseRange(size_type from, size_type to)
+		{
+			std::move(slot(to), slot(count), slot(from));
+			for (size_type i = count - (to - from); i < count; ++i) {
+				at(i).~Type();
+			}
+			count -= to - from;
+		}
+
+		// moves the elements from position from onwards to the end of other
+		void moveTo(Node& other, size_type from)
+		{
+			for (size_type i = from; i < count; ++i) {
+				new (other.slot(other.count++)) Type(std::move(at(i)));
+				at(i).~Type();
+			}
+			count = from;
+		}
+
+	private:
+		Type* slot(size_type index)
+		{
+			return reinterpret_cast<Type*>(&elements[index]);
+		}
+
+		typename std::aligned_storage<sizeof(Type), alignof(Type)>::type elements[CAPACITY];
+	};
+
+	template <typename Type>
+	class UnrolledLinkedList<Type>::ConstIterator {
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = typename UnrolledLinkedList::value_type;
+		using difference_type = typename UnrolledLinkedList::difference_type;
+		using pointer = typename UnrolledLinkedList::const_pointer;
+		using reference = typename UnrolledLinkedList::const_reference;
+
+		friend class UnrolledLinkedList<Type>;
+
+		ConstIterator()
+			: parent(nullptr)
+			, ptr(nullptr)
+			, index(0)
+		{}
+
+		explicit ConstIterator(const UnrolledLinkedList& list, Node* node, size_type index)
+			: parent(&list)
+			, ptr(node)
+			, index(index)
+		{}
+
+		reference operator*() const
+		{
+			if (ptr == nullptr) {
+				throw std::out_of_range("dereferencing end() iterator");
+			}
+			return ptr->at(index);
+		}
+
+		ConstIterator& operator++()
+		{
+			if (ptr == nullptr) {
+				throw std::out_of_range("incrementing end() iterator");
+			}
+			if (++index == ptr->count) {
+				ptr = ptr->next;
+				index = 0;
+			}
+			return *this;
+		}
+
+		ConstIterator operator++(int)
+		{
+			ConstIterator copy = *this;
+			++(*this);
+			return copy;
+		}
+
+		ConstIterator& operator--()
+		{
+			if (ptr == parent->root && index == 0) {
+				throw std::out_of_range("decrementing begin() iterator");
+			}
+			if (index == 0) {
+				ptr = ptr == nullptr ? parent->tail : ptr->prev;
+				index = ptr->count;
+			}
+			--index;
+			return *this;
+		}
+
+		ConstIterator operator--(int)
+		{
+			ConstIterator copy = *this;
+			--(*this);
+			return copy;
+		}
+
+		// skips whole chunks at a time
+		ConstIterator operator+(difference_type d) const
+		{
+			ConstIterator temp = *this;
+			size_type left = static_cast<size_type>(d);
+			while (left) {
+				if (temp.ptr == nullptr) {
+					throw std::out_of_range("incrementing end() iterator");
+				}
+				size_type step = std::min(left, temp.ptr->count - temp.index);
+				temp.index += step;
+				left -= step;
+				if (temp.index == temp.ptr->count) {
+					temp.ptr = temp.ptr->next;
+					temp.index = 0;
+				}
+			}
+			return temp;
+		}
+
+		ConstIterator operator-(difference_type d) const
+		{
+			ConstIterator temp = *this;
+			size_type left = static_cast<size_type>(d);
+			while (left) {
+				if (temp.ptr == parent->root && temp.index == 0) {
+					throw std::out_of_range("decrementing begin() iterator");
+				}
+				if (temp.index == 0) {
+					temp.ptr = temp.ptr == nullptr ? parent->tail : temp.ptr->prev;
+					temp.index = temp.ptr->count;
+				}
+				size_type step = std::min(left, temp.index);
+				temp.index -= step;
+				left -= step;
+			}
+			return temp;
+		}
+
+		pointer operator->() const
+		{
+			return &this->operator*();
+		}
+
+		bool operator==(const ConstIterator& other) const
+		{
+			return ptr == other.ptr && index == other.index;
+		}
+
+		bool operator!=(const ConstIterator& other) const
+		{
+			return !(*this == other);
+		}
+
+	protected:
+		const UnrolledLinkedList<Type>* parent;
+		Node* ptr;
+		size_type index;
+	};
+
+	template <typename Type>
+	class UnrolledLinkedList<Type>::Iterator : public UnrolledLinkedList<Type>::ConstIterator {
+	public:
+		using pointer = typename UnrolledLinkedList::pointer;
+		using reference = typename UnrolledLinkedList::reference;
+
+		Iterator()
+			: ConstIterator()
+		{}
+
+		explicit Iterator(const UnrolledLinkedList& parent, Node* node, size_type index)
+			: ConstIterator(parent, node, index)
+		{}
+
+		Iterator(const ConstIterator& other)
+			: ConstIterator(other)
+		{}
+
+		Iterator& operator++()
+		{
+			ConstIterator::operator++();
+			return *this;
+		}
+
+		Iterator operator++(int)
+		{
+			auto result = *this;
+			ConstIterator::operator++();
+			return result;
+		}
+
+		Iterator& operator--()
+		{
+			ConstIterator::operator--();
+			return *this;
+		}
+
+		Iterator operator--(int)
+		{
+			auto result = *this;
+			ConstIterator::operator--();
+			return result;
+		}
+
+		Iterator operator+(difference_type d) const
+		{
+			return ConstIterator::operator+(d);
+		}
+
+		Iterator operator-(difference_type d) const
+		{
+			return ConstIterator::operator-(d);
+		}
+
+		pointer operator->() const
+		{
+			return &this->operator*();
+		}
+
+		reference operator*() const
+		{
+			return const_cast<reference>(ConstIterator::operator*());
+		}
+	};
+
+}
+
+#endif // AISDI_LINEAR_UNROLLEDLINKEDLIST_H
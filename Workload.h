@@ -0,0 +1,315 @@
+#ifndef AISDI_WORKLOAD_H
+#define AISDI_WORKLOAD_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace aisdi
+{
+
+	enum class KeyDistribution {
+		// 0, 1, 2, ...
+		Sequential,
+		// n - 1, n - 2, ..., 0
+		Reverse,
+		// random 64-bit keys
+		Uniform,
+		// a few hot keys repeat often, so the key stream contains duplicates
+		Zipf,
+		// short ascending runs of neighbouring keys around random bases
+		Clustered,
+		// keys that all land in the same bucket of a HashMap that has not grown yet
+		Adversarial
+	};
+
+	enum class OperationType {
+		Read,
+		Update,
+		Insert,
+		Scan,
+		ReadModifyWrite
+	};
+
+	// key is an index into the workload's key vector; length is only used by scans
+	struct Operation {
+		OperationType type;
+		std::size_t key;
+		std::size_t length;
+	};
+
+	// proportions of each operation type and whether requests favour the newest keys instead of
+	// the zipfian hot set
+	struct OperationMix {
+		char name;
+		double read;
+		double update;
+		double insert;
+		double scan;
+		double read_modify_write;
+		bool latest;
+	};
+
+	// the core YCSB workloads A-F
+	inline OperationMix ycsbMix(char workload)
+	{
+		switch (workload) {
+		case 'A': return { 'A', 0.5, 0.5, 0, 0, 0, false };
+		case 'B': return { 'B', 0.95, 0.05, 0, 0, 0, false };
+		case 'C': return { 'C', 1, 0, 0, 0, 0, false };
+		case 'D': return { 'D', 0.95, 0, 0.05, 0, 0, true };
+		case 'E': return { 'E', 0, 0, 0.05, 0.95, 0, false };
+		case 'F': return { 'F', 0.5, 0, 0, 0, 0.5, false };
+		default: throw std::invalid_argument("unknown YCSB workload");
+		}
+	}
+
+	// draws ranks 0..n-1 where rank r has weight 1/(r + 1)^skew
+	class ZipfGenerator {
+	public:
+		using size_type = std::size_t;
+
+		ZipfGenerator(size_type n, double skew)
+		{
+			if (n == 0) {
+				throw std::invalid_argument("zipf distribution needs at least one rank");
+			}
+			double total = 0;
+			for (size_type rank = 1; rank <= n; ++rank) {
+				total += 1 / std::pow(static_cast<double>(rank), skew);
+				cdf.push_back(total);
+			}
+		}
+
+		template <typename Random>
+		size_type operator()(Random& random) const
+		{
+			std::uniform_real_distribution<double> uniform(0, cdf.back());
+			size_type rank = std::lower_bound(cdf.begin(), cdf.end(), uniform(random)) - cdf.begin();
+			return std::min(rank, cdf.size() - 1);
+		}
+
+	private:
+		std::vector<double> cdf;
+	};
+
+	// Builds key sets and operation streams for the benchmarks. String keys have a fixed length and
+	// sort in the same order as the integers they were made from.
+	class WorkloadGenerator {
+	public:
+		using size_type = std::size_t;
+
+		static const size_type CLUSTER_SIZE = 64;
+		static const size_type MAX_SCAN_LENGTH = 100;
+
+		explicit WorkloadGenerator(std::uint64_t seed = 5489u, double skew = 0.99)
+			: seed(seed)
+			, skew(skew)
+		{}
+
+		std::vector<std::uint64_t> integerKeys(KeyDistribution distribution, size_type count) const
+		{
+			std::mt19937_64 random(seed);
+			std::vector<std::uint64_t> keys;
+			keys.reserve(count);
+			switch (distribution) {
+			case KeyDistribution::Sequential:
+				for (size_type i = 0; i < count; ++i) {
+					keys.push_back(i);
+				}
+				break;
+			case KeyDistribution::Reverse:
+				for (size_type i = count; i > 0; --i) {
+					keys.push_back(i - 1);
+				}
+				break;
+			case KeyDistribution::Uniform:
+				for (size_type i = 0; i < count; ++i) {
+					keys.push_back(random());
+				}
+				break;
+			case KeyDistribution::Zipf:
+				if (count != 0) {
+					// ranks are scrambled so that the hot keys are spread over the key space
+					ZipfGenerator zipf(count, skew);
+					for (size_type i = 0; i < count; ++i) {
+						keys.push_back(scramble(zipf(random)));
+					}
+				}
+				break;
+			case KeyDistribution::Clustered:
+				while (keys.size() < count) {
+					std::uint64_t base = random() & ~static_cast<std::uint64_t>(CLUSTER_SIZE - 1);
+					for (size_type i = 0; i < CLUSTER_SIZE && keys.size() < count; ++i) {
+						keys.push_back(base + i);
+					}
+				}
+				break;
+			case KeyDistribution::Adversarial:
+				// k * FIBONACCI_MULTIPLIER == i, whose top bits are zero, so the integral HashMap puts
+				// every key in slot 0 no matter how far it grows
+				for (size_type i = 0; i < count; ++i) {
+					keys.push_back(i * inverse(FIBONACCI_MULTIPLIER));
+				}
+				break;
+			}
+			return keys;
+		}
+
+		// Keys are length characters long; shorter than 11 they keep only the low base-62 digits.
+		// Adversarial keys are searched for so that std::hash puts them all into the same one of
+		// bucket_count buckets, which makes them expensive to generate.
+		std::vector<std::string> stringKeys(KeyDistribution distribution, size_type count, size_type length,
+			size_type bucket_count = DEFAULT_BUCKET_COUNT) const
+		{
+			if (length == 0) {
+				throw std::invalid_argument("string keys need at least one character");
+			}
+			std::vector<std::string> keys;
+			keys.reserve(count);
+			if (distribution != KeyDistribution::Adversarial) {
+				for (std::uint64_t key : integerKeys(distribution, count)) {
+					keys.push_back(encode(key, length));
+				}
+				return keys;
+			}
+
+			std::hash<std::string> hash;
+			for (std::uint64_t candidate = 0; keys.size() < count; ++candidate) {
+				std::string key = encode(candidate, length);
+				if (hash(key) % bucket_count == 0) {
+					keys.push_back(key);
+				}
+				if (length < 11 && candidate + 1 == power(62, length)) {
+					throw std::invalid_argument("not enough colliding keys of this length");
+				}
+			}
+			// the candidates were tried in ascending order, which would hand TreeMap sorted input as well
+			std::shuffle(keys.begin(), keys.end(), std::mt19937_64(seed));
+			return keys;
+		}
+
+		// The first records keys are loaded up front; every insert takes the next unused key, so
+		// a key vector of records + countInserts() keys covers the whole stream.
+		std::vector<Operation> operations(const OperationMix& mix, size_type records, size_type count) const
+		{
+			if (records == 0) {
+				throw std::invalid_argument("workload needs at least one loaded record");
+			}
+			std::mt19937_64 random(seed ^ 0x5DEECE66Dull);
+			std::uniform_real_distribution<double> uniform(0, mix.read + mix.update + mix.insert + mix.scan
+				+ mix.read_modify_write);
+			std::uniform_int_distribution<size_type> scan_length(1, MAX_SCAN_LENGTH);
+			ZipfGenerator zipf(records, skew);
+			// hot ranks map to random records rather than to the first ones loaded
+			std::vector<size_type> records_by_rank(records);
+			for (size_type i = 0; i < records; ++i) {
+				records_by_rank[i] = i;
+			}
+			std::shuffle(records_by_rank.begin(), records_by_rank.end(), random);
+
+			std::vector<Operation> result;
+			result.reserve(count);
+			size_type inserted = records;
+			for (size_type i = 0; i < count; ++i) {
+				double choice = uniform(random);
+				Operation operation = { OperationType::Read, 0, 0 };
+				if ((choice -= mix.read) < 0) {
+					operation.type = OperationType::Read;
+				}
+				else if ((choice -= mix.update) < 0) {
+					operation.type = OperationType::Update;
+				}
+				else if ((choice -= mix.insert) < 0) {
+					operation.type = OperationType::Insert;
+				}
+				else if ((choice -= mix.scan) < 0) {
+					operation.type = OperationType::Scan;
+					operation.length = scan_length(random);
+				}
+				else {
+					operation.type = OperationType::ReadModifyWrite;
+				}
+
+				if (operation.type == OperationType::Insert) {
+					operation.key = inserted++;
+				}
+				else if (mix.latest) {
+					operation.key = inserted - 1 - std::min(zipf(random), inserted - 1);
+				}
+				else {
+					operation.key = records_by_rank[zipf(random)];
+				}
+				result.push_back(operation);
+			}
+			return result;
+		}
+
+		static size_type countInserts(const std::vector<Operation>& operations)
+		{
+			return std::count_if(operations.begin(), operations.end(),
+				[](const Operation& operation) { return operation.type == OperationType::Insert; });
+		}
+
+		// the text is irrelevant, only the size matters: up to 15 bytes fit in std::string itself
+		static std::string value(size_type size)
+		{
+			return std::string(size, 'v');
+		}
+
+	private:
+		static const std::uint64_t FIBONACCI_MULTIPLIER = 0x9E3779B97F4A7C15ull;
+		static const size_type DEFAULT_BUCKET_COUNT = 10000;
+
+		std::uint64_t seed;
+		double skew;
+
+		// multiplicative inverse modulo 2^64 by Newton's iteration; every step doubles the correct bits
+		static std::uint64_t inverse(std::uint64_t odd)
+		{
+			std::uint64_t result = odd;
+			for (int i = 0; i < 5; ++i) {
+				result *= 2 - odd * result;
+			}
+			return result;
+		}
+
+		static std::uint64_t scramble(std::uint64_t rank)
+		{
+			// splitmix64 finalizer, a bijection
+			rank = (rank ^ (rank >> 30)) * 0xBF58476D1CE4E5B9ull;
+			rank = (rank ^ (rank >> 27)) * 0x94D049BB133111EBull;
+			return rank ^ (rank >> 31);
+		}
+
+		static std::uint64_t power(std::uint64_t base, size_type exponent)
+		{
+			std::uint64_t result = 1;
+			for (size_type i = 0; i < exponent; ++i) {
+				result *= base;
+			}
+			return result;
+		}
+
+		// fixed-width base 62 with digits in ASCII order, so comparing keys compares the integers
+		static std::string encode(std::uint64_t key, size_type length)
+		{
+			static const char digits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+			std::string text(length, '0');
+			for (size_type i = length; i > 0 && key != 0; --i) {
+				text[i - 1] = digits[key % 62];
+				key /= 62;
+			}
+			return text;
+		}
+	};
+
+}
+
+#endif /* AISDI_WORKLOAD_H */
@@ -6,124 +6,1817 @@
 #include <functional>
 #include <vector>
 #include <typeinfo>
-#include <string>
+#include <string>
 #include <ctime>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
 
+#include "Benchmark.h"
+#include "BenchmarkBaseline.h"
+#include "ConcurrentQueue.h"
+#include "ConcurrentSkipListMap.h"
+#include "FilteredMap.h"
+#include "FlatMap.h"
+#include "FrozenTreeMap.h"
 #include "HashMap.h"
+#include "LinkedList.h"
+#include "LruCache.h"
+#include "LsmStore.h"
+#define AISDI_TRACK_ALLOCATIONS
+#include "MemoryTracker.h"
+#include "PersistentTreeMap.h"
+#include "RadixTreeMap.h"
+#include "StdMapAdapter.h"
+#include "ThreadPool.h"
 #include "TreeMap.h"
+#include "UnrolledLinkedList.h"
+#include "Workload.h"
 
 template <typename Collection>
 class Tests {
 private:
+	using Test = std::function<void(aisdi::BenchmarkState&)>;
+
 	int repeat_count;
-	std::chrono::high_resolution_clock::time_point begin, end;
-	std::vector<std::pair<std::string, std::function<void()>>> tests;
+	std::vector<std::pair<std::string, Test>> tests;
 	std::vector<int> indexes;
+	aisdi::ThreadPool pool;
 
-	void start()
-	{
-		begin = std::chrono::high_resolution_clock::now();
-	}
-
-	void finish()
-	{
-		end = std::chrono::high_resolution_clock::now();
-	}
-
-	double delta() const
+	void fill(Collection& collection, int count) const
 	{
-		return std::chrono::duration<double, std::milli>(end - begin).count();
+		for (int i = 0; i < count; ++i) {
+			collection[indexes[i]] = "test";
+		}
 	}
 
 public:
 	Tests(int n)
 		: repeat_count(n)
 		, tests({
-			std::make_pair("inserting into empty map", [this]()->void
+			std::make_pair("inserting into empty map", [this](aisdi::BenchmarkState& state)
 			{
 				Collection collection;
-				this->start();
+				state.start();
 				for (int i = 0; i < this->repeat_count; ++i) {
 					collection[this->indexes[i]] = "test";
 				}
-				this->finish();
+				aisdi::clobberMemory();
+				state.stop();
 			}),
-			std::make_pair("removing from non-empty map", [this]()->void
+			std::make_pair("removing from non-empty map", [this](aisdi::BenchmarkState& state)
 			{
 				Collection collection;
-				for (int i = 0; i < this->repeat_count; ++i) {
-					collection[this->indexes[i]] = "test";
-				}
-				this->start();
+				this->fill(collection, this->repeat_count);
+				state.start();
 				for (int i = 0; i < this->repeat_count; ++i) {
 					collection.remove(i);
 				}
-				this->finish();
+				aisdi::clobberMemory();
+				state.stop();
 			}),
-			std::make_pair("searching for element with given key (n/2 elements)", [this]()->void
+			std::make_pair("searching for element with given key (n/2 elements)", [this](aisdi::BenchmarkState& state)
 			{
 				Collection collection;
-				for (int i = 0; i < this->repeat_count/2; ++i) {
-					collection[this->indexes[i]] = "test";
-				}
-				this->start();
+				this->fill(collection, this->repeat_count / 2);
+				state.start();
 				for (int i = 0; i < this->repeat_count; ++i) {
-					(void)collection.find(i);
+					aisdi::doNotOptimize(collection.find(i));
 				}
-				this->finish();
+				state.stop();
 			}),
-			std::make_pair("searching for element with given key (n elements)", [this]()->void
+			std::make_pair("searching for element with given key (n elements)", [this](aisdi::BenchmarkState& state)
 			{
 				Collection collection;
+				this->fill(collection, this->repeat_count);
+				state.start();
 				for (int i = 0; i < this->repeat_count; ++i) {
-					collection[this->indexes[i]] = "test";
-				}
-				this->start();
-				for (int i = 0; i < this->repeat_count; ++i) {
-					(void)collection.find(i);
+					aisdi::doNotOptimize(collection.find(i));
 				}
-				this->finish();
+				state.stop();
 			}),
-			std::make_pair("iterating through map", [this]()->void
+			std::make_pair("iterating through map", [this](aisdi::BenchmarkState& state)
 			{
 				Collection collection;
-				for (int i = 0; i < this->repeat_count; ++i) {
-					collection[this->indexes[i]] = "test";
+				this->fill(collection, this->repeat_count);
+				state.start();
+				for (auto it = collection.begin(); it != collection.end(); ++it) {
+					aisdi::doNotOptimize(*it);
 				}
-				this->start();
+				state.stop();
+			}),
+			std::make_pair("summing value lengths sequentially", [this](aisdi::BenchmarkState& state)
+			{
+				Collection collection;
+				this->fill(collection, this->repeat_count);
+				state.start();
+				std::size_t sum = 0;
 				for (auto it = collection.begin(); it != collection.end(); ++it) {
-					(void)it;
+					sum += it->second.size();
 				}
-				this->finish();
+				aisdi::doNotOptimize(sum);
+				state.stop();
+			}),
+			std::make_pair("summing value lengths with parallelReduce", [this](aisdi::BenchmarkState& state)
+			{
+				Collection collection;
+				this->fill(collection, this->repeat_count);
+				state.start();
+				std::size_t sum = collection.parallelReduce(this->pool, std::size_t(0),
+					[](const typename Collection::value_type& item) { return item.second.size(); },
+					[](std::size_t a, std::size_t b) { return a + b; });
+				aisdi::doNotOptimize(sum);
+				state.stop();
+			}),
+			std::make_pair("iterating through map with parallelForEach", [this](aisdi::BenchmarkState& state)
+			{
+				Collection collection;
+				this->fill(collection, this->repeat_count);
+				state.start();
+				collection.parallelForEach(this->pool, [](typename Collection::value_type& item) { aisdi::doNotOptimize(item); });
+				state.stop();
 			}),
 
 		})
 	{
-		for (int i = 0; i < repeat_count; ++i) {
-			indexes.push_back(i);
-		}
+		for (int i = 0; i < repeat_count; ++i) {
+			indexes.push_back(i);
+		}
 		std::random_shuffle(indexes.begin(), indexes.end());
 	}
 
-	void runTests()
+	void runTests(aisdi::BenchmarkRunner& runner)
 	{
-		std::cout << "=== Running " << typeid(Collection).name() << " tests ===\n";
+		runner.beginSuite(std::string(typeid(Collection).name()) + " tests");
 		for (const auto& test : tests) {
-			std::cout << test.first << "...";
-			test.second();
-			std::cout << " -> "<< delta() << "ms\n";
-		}
-		std::cout << std::endl;
-	}
-};
-
-int main(int argc, char** argv)
-{
-	const int repeat_count = argc > 1 ? std::atoll(argv[1]) : 100000;
-	Tests<aisdi::HashMap<int, std::string>> hashmap_tests(repeat_count);
-	Tests<aisdi::TreeMap<int, std::string>> treemap_tests(repeat_count);
-	hashmap_tests.runTests();
-	treemap_tests.runTests();
-	return 0;
+			runner.run(test.first, repeat_count, test.second);
+		}
+		runner.endSuite();
+	}
+};
+
+template <typename KeyType, typename ValueType>
+class LockedTreeMap {
+public:
+	bool upsert(const KeyType& key, const ValueType& value)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		bool inserted = map.find(key) == map.end();
+		map[key] = value;
+		return inserted;
+	}
+
+	bool remove(const KeyType& key)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = map.find(key);
+		if (it == map.end()) {
+			return false;
+		}
+		map.remove(it);
+		return true;
+	}
+
+	bool contains(const KeyType& key) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return map.find(key) != map.end();
+	}
+
+private:
+	mutable std::mutex mutex;
+	aisdi::TreeMap<KeyType, ValueType> map;
+};
+
+template <typename Collection>
+class ConcurrentTests {
+private:
+	int repeat_count;
+	std::vector<unsigned> thread_counts;
+	std::vector<int> indexes;
+
+public:
+	ConcurrentTests(int n)
+		: repeat_count(n)
+	{
+		unsigned max_threads = std::max(4u, 2 * std::thread::hardware_concurrency());
+		for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+			thread_counts.push_back(threads);
+		}
+		for (int i = 0; i < repeat_count; i += 2) {
+			indexes.push_back(i);
+		}
+		std::shuffle(indexes.begin(), indexes.end(), std::mt19937());
+	}
+
+	void runTests(aisdi::BenchmarkRunner& runner)
+	{
+		runner.beginSuite(std::string(typeid(Collection).name()) + " concurrent tests");
+		for (unsigned threads : thread_counts) {
+			std::string name = "mixed 80% find / 10% upsert / 10% remove, " + std::to_string(threads) + " threads";
+			runner.run(name, threads * std::size_t(repeat_count), [this, threads](aisdi::BenchmarkState& state)
+			{
+				Collection collection;
+				for (int index : this->indexes) {
+					collection.upsert(index, "test");
+				}
+
+				std::vector<std::thread> workers;
+				state.start();
+				for (unsigned t = 0; t < threads; ++t) {
+					workers.emplace_back([this, &collection, t]()
+					{
+						std::mt19937 random(t);
+						for (int i = 0; i < this->repeat_count; ++i) {
+							int key = random() % this->repeat_count;
+							unsigned operation = random() % 10;
+							if (operation == 0) {
+								collection.upsert(key, "test");
+							}
+							else if (operation == 1) {
+								collection.remove(key);
+							}
+							else {
+								aisdi::doNotOptimize(collection.contains(key));
+							}
+						}
+					});
+				}
+				for (auto& worker : workers) {
+					worker.join();
+				}
+				state.stop();
+			});
+		}
+		runner.endSuite();
+	}
+};
+
+template <typename Type>
+class LockedQueue {
+public:
+	void append(const Type& item)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			list.append(item);
+		}
+		condition.notify_one();
+	}
+
+	Type popFirst()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this]() { return !list.isEmpty(); });
+		return list.popFirst();
+	}
+
+	template <typename OutputIt>
+	std::size_t popMany(OutputIt out, std::size_t max_count)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::size_t count = 0;
+		for (; count < max_count && !list.isEmpty(); ++count) {
+			*out++ = list.popFirst();
+		}
+		return count;
+	}
+
+private:
+	std::mutex mutex;
+	std::condition_variable condition;
+	aisdi::LinkedList<Type> list;
+};
+
+template <typename Queue>
+class QueueTests {
+private:
+	int repeat_count;
+	std::vector<unsigned> thread_counts;
+
+public:
+	QueueTests(int n)
+		: repeat_count(n)
+	{
+		unsigned max_threads = std::max(4u, std::thread::hardware_concurrency());
+		for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+			thread_counts.push_back(threads);
+		}
+	}
+
+	void runTests(aisdi::BenchmarkRunner& runner)
+	{
+		runner.beginSuite(std::string(typeid(Queue).name()) + " producer/consumer tests");
+		for (unsigned threads : thread_counts) {
+			run(runner, threads, false);
+			run(runner, threads, true);
+		}
+		runner.endSuite();
+	}
+
+private:
+	// threads producers and as many consumers; each consumer takes exactly its share of the items
+	void run(aisdi::BenchmarkRunner& runner, unsigned threads, bool batched)
+	{
+		const std::size_t batch_size = 64;
+		int per_thread = repeat_count / threads;
+		std::string name = std::to_string(threads) + " producers / " + std::to_string(threads) + " consumers, "
+			+ (batched ? "popMany" : "popFirst");
+
+		runner.run(name, threads * std::size_t(per_thread), [=](aisdi::BenchmarkState&)
+		{
+			Queue queue;
+			std::vector<std::thread> workers;
+			for (unsigned t = 0; t < threads; ++t) {
+				workers.emplace_back([&queue, per_thread]()
+				{
+					for (int i = 0; i < per_thread; ++i) {
+						queue.append(i);
+					}
+				});
+				workers.emplace_back([&queue, per_thread, batched, batch_size]()
+				{
+					long long sum = 0;
+					std::vector<int> batch;
+					for (int left = per_thread; left > 0;) {
+						if (batched) {
+							batch.clear();
+							left -= static_cast<int>(queue.popMany(std::back_inserter(batch),
+								std::min<std::size_t>(batch_size, left)));
+							for (int value : batch) {
+								sum += value;
+							}
+						}
+						else {
+							sum += queue.popFirst();
+							--left;
+						}
+					}
+					aisdi::doNotOptimize(sum);
+				});
+			}
+			for (auto& worker : workers) {
+				worker.join();
+			}
+		});
+	}
+};
+
+class SkewedAccessTests {
+private:
+	int repeat_count;
+	double skew;
+	std::vector<int> indexes;
+	std::vector<int> lookups;
+
+public:
+	SkewedAccessTests(int n, double skew)
+		: repeat_count(n)
+		, skew(skew)
+	{
+		std::mt19937 random;
+		for (int i = 0; i < repeat_count; ++i) {
+			indexes.push_back(i);
+		}
+		std::shuffle(indexes.begin(), indexes.end(), random);
+
+		// rank r is drawn with weight 1/r^skew; ranks map to random keys so hot keys start anywhere in the tree
+		std::vector<double> cdf;
+		double total = 0;
+		for (int rank = 1; rank <= repeat_count; ++rank) {
+			total += 1 / std::pow(rank, skew);
+			cdf.push_back(total);
+		}
+		std::vector<int> keys_by_rank = indexes;
+		std::shuffle(keys_by_rank.begin(), keys_by_rank.end(), random);
+		std::uniform_real_distribution<double> uniform(0, total);
+		for (int i = 0; i < repeat_count; ++i) {
+			std::size_t rank = std::lower_bound(cdf.begin(), cdf.end(), uniform(random)) - cdf.begin();
+			lookups.push_back(keys_by_rank[std::min<std::size_t>(rank, repeat_count - 1)]);
+		}
+	}
+
+	void runTests(aisdi::BenchmarkRunner& runner)
+	{
+		const std::pair<const char*, aisdi::TreeAccessPolicy> policies[] = {
+			{ "static", aisdi::TreeAccessPolicy::Static },
+			{ "splay", aisdi::TreeAccessPolicy::Splay },
+			{ "semi-splay", aisdi::TreeAccessPolicy::SemiSplay },
+		};
+
+		std::ostringstream suite;
+		suite << "TreeMap Zipf(" << skew << ") lookup tests";
+		runner.beginSuite(suite.str());
+		for (const auto& policy : policies) {
+			std::string name = std::string("searching skewed keys, ") + policy.first + " tree";
+			runner.run(name, repeat_count, [this, &policy](aisdi::BenchmarkState& state)
+			{
+				aisdi::TreeMap<int, std::string> collection;
+				collection.setAccessPolicy(policy.second);
+				for (int index : this->indexes) {
+					collection[index] = "test";
+				}
+
+				std::size_t found = 0;
+				state.start();
+				for (int key : this->lookups) {
+					found += collection.find(key) != collection.end();
+				}
+				aisdi::doNotOptimize(found);
+				state.stop();
+				state.setCounter("found", found);
+			});
+		}
+		runner.endSuite();
+	}
+};
+
+template <typename Collection>
+class ReadMostlyTests {
+private:
+	int repeat_count;
+	std::vector<int> indexes;
+	std::vector<int> lookups;
+
+public:
+	ReadMostlyTests(int n)
+		: repeat_count(n)
+	{
+		std::mt19937 random;
+		for (int i = 0; i < repeat_count; ++i) {
+			indexes.push_back(i);
+		}
+		std::shuffle(indexes.begin(), indexes.end(), random);
+		lookups = indexes;
+		std::shuffle(lookups.begin(), lookups.end(), random);
+	}
+
+	void runTests(aisdi::BenchmarkRunner& runner)
+	{
+		runner.beginSuite(std::string(typeid(Collection).name()) + " read-mostly tests");
+		Collection collection;
+		for (int index : indexes) {
+			collection[index] = "test";
+		}
+		double bytes_per_entry = static_cast<double>(collection.getMemoryUsage()) / collection.getSize();
+
+		runner.run("searching random keys", repeat_count, [this, &collection, bytes_per_entry](aisdi::BenchmarkState& state)
+		{
+			std::size_t found = 0;
+			for (int key : this->lookups) {
+				found += collection.find(key)->second.size();
+			}
+			aisdi::doNotOptimize(found);
+			state.setCounter("bytes_per_entry", bytes_per_entry);
+		});
+		runner.run("iterating through map", repeat_count, [&collection](aisdi::BenchmarkState&)
+		{
+			std::size_t found = 0;
+			for (auto it = collection.begin(); it != collection.end(); ++it) {
+				found += it->second.size();
+			}
+			aisdi::doNotOptimize(found);
+		});
+		runner.endSuite();
+	}
+};
+
+class FrozenLookupTests {
+private:
+	int repeat_count;
+	std::vector<int> lookups;
+
+public:
+	FrozenLookupTests(int n)
+		: repeat_count(n)
+	{
+		// half of the probes miss, landing between stored (even) keys
+		std::mt19937 random;
+		std::uniform_int_distribution<int> key(0, 2 * repeat_count - 1);
+		for (int i = 0; i < repeat_count; ++i) {
+			lookups.push_back(key(random));
+		}
+	}
+
+	void runTests(aisdi::BenchmarkRunner& runner)
+	{
+		std::vector<std::pair<int, int>> sorted;
+		for (int i = 0; i < repeat_count; ++i) {
+			sorted.emplace_back(2 * i, i);
+		}
+		const auto tree = aisdi::TreeMap<int, int>::fromSorted(sorted.begin(), sorted.end());
+		const aisdi::FrozenTreeMap<int, int> frozen(tree);
+
+		runner.beginSuite("FrozenTreeMap tests");
+		measure(runner, "TreeMap::find", [&tree](int key) { return tree.find(key) != tree.end(); });
+		measure(runner, "FrozenTreeMap::find", [&frozen](int key) { return frozen.find(key) != frozen.end(); });
+		measure(runner, "TreeMap::lowerBound", [&tree](int key) { return tree.lowerBound(key) != tree.end(); });
+		measure(runner, "FrozenTreeMap::lowerBound", [&frozen](int key) { return frozen.lowerBound(key) != frozen.end(); });
+		runner.endSuite();
+	}
+
+private:
+	template <typename Function>
+	void measure(aisdi::BenchmarkRunner& runner, const char* name, Function lookup)
+	{
+		runner.run(name, repeat_count, [this, &lookup](aisdi::BenchmarkState& state)
+		{
+			std::size_t found = 0;
+			for (int key : this->lookups) {
+				found += lookup(key);
+			}
+			aisdi::doNotOptimize(found);
+			state.setCounter("found", found);
+		});
+	}
+};
+
+template <typename Collection>
+class KeyTypeTests {
+private:
+	using key_type = typename Collection::key_type;
+
+	const char* key_name;
+	std::vector<key_type> keys;
+
+public:
+	KeyTypeTests(const char* key_name, std::vector<key_type> keys)
+		: key_name(key_name)
+		, keys(std::move(keys))
+	{}
+
+	void runTests(aisdi::BenchmarkRunner& runner)
+	{
+		runner.beginSuite(std::string(typeid(Collection).name()) + " " + key_name + " key tests");
+		runner.run(std::string("inserting ") + key_name + " keys", keys.size(), [this](aisdi::BenchmarkState& state)
+		{
+			Collection collection;
+			state.start();
+			for (const key_type& key : this->keys) {
+				collection[key] = 1;
+			}
+			aisdi::clobberMemory();
+			state.stop();
+		});
+
+		Collection collection;
+		for (const key_type& key : keys) {
+			collection[key] = 1;
+		}
+		runner.run(std::string("searching for ") + key_name + " keys", keys.size(), [this, &collection](aisdi::BenchmarkState&)
+		{
+			std::size_t found = 0;
+			for (const key_type& key : this->keys) {
+				found += collection.find(key) != collection.end();
+			}
+			aisdi::doNotOptimize(found);
+		});
+		runner.run(std::string("iterating through ") + key_name + " keys", collection.getSize(), [&collection](aisdi::BenchmarkState&)
+		{
+			std::size_t sum = 0;
+			for (auto it = collection.begin(); it != collection.end(); ++it) {
+				sum += it->second;
+			}
+			aisdi::doNotOptimize(sum);
+		});
+		runner.endSuite();
+	}
+};
+
+class LsmTests {
+private:
+	using Store = aisdi::LsmStore<int, std::string>;
+
+	int repeat_count;
+	std::vector<int> keys;
+	std::string path;
+	aisdi::LsmOptions options;
+
+	void ingest(Store& store) const
+	{
+		for (int key : keys) {
+			store.put(key, "test");
+		}
+	}
+
+	void ingestAscending(Store& store) const
+	{
+		for (int key = 0; key < repeat_count; ++key) {
+			store.put(key, "test");
+		}
+	}
+
+public:
+	LsmTests(int n)
+		: repeat_count(n)
+		, path("aisdi_lsm_benchmark")
+	{
+		std::mt19937 random;
+		for (int i = 0; i < repeat_count; ++i) {
+			keys.push_back(static_cast<int>(random() % (4 * repeat_count)));
+		}
+		options.memtable_limit = std::max(repeat_count / 32, 1024);
+	}
+
+	void runTests(aisdi::BenchmarkRunner& runner)
+	{
+		runner.beginSuite("LsmStore tests");
+		runner.run("ingesting keys", repeat_count, [this](aisdi::BenchmarkState& state)
+		{
+			Store::destroy(this->path);
+			Store store(this->path, this->options);
+			state.start();
+			this->ingest(store);
+			state.stop();
+			state.setCounter("runs", store.getRunCount());
+		});
+		runner.run("ingesting ascending keys", repeat_count, [this](aisdi::BenchmarkState& state)
+		{
+			Store::destroy(this->path);
+			Store store(this->path, this->options);
+			state.start();
+			this->ingestAscending(store);
+			state.stop();
+			state.setCounter("runs", store.getRunCount());
+		});
+		runner.run("waiting for compaction", 1, [this](aisdi::BenchmarkState& state)
+		{
+			Store::destroy(this->path);
+			Store store(this->path, this->options);
+			this->ingest(store);
+			state.start();
+			store.waitForCompaction();
+			state.stop();
+			state.setCounter("runs", store.getRunCount());
+		});
+
+		Store::destroy(path);
+		{
+			Store store(path, options);
+			ingest(store);
+			store.waitForCompaction();
+			runner.run("point reads", repeat_count, [this, &store](aisdi::BenchmarkState&)
+			{
+				std::size_t found = 0;
+				for (int key : this->keys) {
+					found += store.contains(key + 1);
+				}
+				aisdi::doNotOptimize(found);
+			});
+			int scans = std::max(repeat_count / 100, 1);
+			runner.run("range reads of 100 keys", scans, [this, &store, scans](aisdi::BenchmarkState&)
+			{
+				std::size_t found = 0;
+				for (int i = 0; i < scans; ++i) {
+					store.forEachInRange(this->keys[i], this->keys[i] + 100, [&found](const int&, const std::string& value) {
+						found += value.size();
+					});
+				}
+				aisdi::doNotOptimize(found);
+			});
+		}
+		Store::destroy(path);
+		runner.endSuite();
+	}
+};
+
+template <typename Collection>
+class MissHeavyTests {
+private:
+	int repeat_count;
+	std::vector<int> present;
+
+public:
+	MissHeavyTests(int n)
+		: repeat_count(n)
+	{
+		std::mt19937 random;
+		for (int i = 0; i < repeat_count / 2; ++i) {
+			present.push_back(2 * i);
+		}
+		std::shuffle(present.begin(), present.end(), random);
+	}
+
+	void runTests(aisdi::BenchmarkRunner& runner)
+	{
+		const double miss_ratios[] = { 0.5, 0.9, 0.99 };
+
+		runner.beginSuite(std::string(typeid(Collection).name()) + " miss-heavy tests");
+		Collection collection;
+		for (int key : present) {
+			collection[key] = "test";
+		}
+
+		std::mt19937 random;
+		for (double miss_ratio : miss_ratios) {
+			// stored keys are even, so odd keys always miss
+			std::bernoulli_distribution miss(miss_ratio);
+			std::uniform_int_distribution<int> index(0, static_cast<int>(present.size()) - 1);
+			std::vector<int> lookups;
+			for (int i = 0; i < repeat_count; ++i) {
+				int key = present[index(random)];
+				lookups.push_back(miss(random) ? key + 1 : key);
+			}
+
+			std::string name = "searching keys, " + std::to_string(static_cast<int>(miss_ratio * 100)) + "% misses";
+			runner.run(name, repeat_count, [&collection, &lookups](aisdi::BenchmarkState&)
+			{
+				std::size_t found = 0;
+				for (int key : lookups) {
+					auto search = collection.find(key);
+					found += search != collection.end() ? search->second.size() : 0;
+				}
+				aisdi::doNotOptimize(found);
+			});
+		}
+		runner.endSuite();
+	}
+};
+
+template <typename Collection>
+class LatencyTests {
+private:
+	int repeat_count;
+	std::vector<int> indexes;
+
+	void fill(Collection& collection) const
+	{
+		for (int index : indexes) {
+			collection[index] = "test";
+		}
+	}
+
+public:
+	LatencyTests(int n)
+		: repeat_count(n)
+	{
+		std::mt19937 random;
+		for (int i = 0; i < repeat_count; ++i) {
+			indexes.push_back(i);
+		}
+		std::shuffle(indexes.begin(), indexes.end(), random);
+	}
+
+	// every operation is timed on its own, so rehashing or a deep path shows up in the tail
+	void runTests(aisdi::BenchmarkRunner& runner)
+	{
+		runner.beginSuite(std::string(typeid(Collection).name()) + " latency tests");
+		runner.run("inserting into empty map", repeat_count, [this](aisdi::BenchmarkState& state)
+		{
+			Collection collection;
+			state.start();
+			for (int index : this->indexes) {
+				state.sample([&collection, index]() { collection[index] = "test"; });
+			}
+			aisdi::clobberMemory();
+			state.stop();
+		});
+		runner.run("searching for element with given key", repeat_count, [this](aisdi::BenchmarkState& state)
+		{
+			Collection collection;
+			this->fill(collection);
+			state.start();
+			for (int i = 0; i < this->repeat_count; ++i) {
+				state.sample([&collection, i]() { aisdi::doNotOptimize(collection.find(i)); });
+			}
+			state.stop();
+		});
+		runner.run("removing from non-empty map", repeat_count, [this](aisdi::BenchmarkState& state)
+		{
+			Collection collection;
+			this->fill(collection);
+			state.start();
+			for (int i = 0; i < this->repeat_count; ++i) {
+				state.sample([&collection, i]() { collection.remove(i); });
+			}
+			aisdi::clobberMemory();
+			state.stop();
+		});
+		runner.endSuite();
+	}
+};
+
+template <typename Collection>
+class ListTests {
+private:
+	int repeat_count;
+
+	void fill(Collection& collection) const
+	{
+		for (int i = 0; i < repeat_count; ++i) {
+			collection.append(i);
+		}
+	}
+
+public:
+	ListTests(int n)
+		: repeat_count(n)
+	{}
+
+	void runTests(aisdi::BenchmarkRunner& runner)
+	{
+		runner.beginSuite(std::string(typeid(Collection).name()) + " list tests");
+		runner.run("appending elements", repeat_count, [this](aisdi::BenchmarkState& state)
+		{
+			Collection collection;
+			state.start();
+			this->fill(collection);
+			aisdi::clobberMemory();
+			state.stop();
+		});
+
+		Collection collection;
+		fill(collection);
+		runner.run("iterating elements", repeat_count, [&collection](aisdi::BenchmarkState&)
+		{
+			long long sum = 0;
+			for (int value : collection) {
+				sum += value;
+			}
+			aisdi::doNotOptimize(sum);
+		});
+
+		const int jump_count = 100;
+		runner.run("advancing to random positions", jump_count, [this, &collection, jump_count](aisdi::BenchmarkState&)
+		{
+			std::mt19937 random;
+			std::uniform_int_distribution<int> offset(0, this->repeat_count - 1);
+			long long sum = 0;
+			for (int i = 0; i < jump_count; ++i) {
+				sum += *(collection.begin() + offset(random));
+			}
+			aisdi::doNotOptimize(sum);
+		});
+
+		runner.run("popping elements", repeat_count, [this](aisdi::BenchmarkState& state)
+		{
+			Collection collection;
+			this->fill(collection);
+			long long sum = 0;
+			state.start();
+			while (!collection.isEmpty()) {
+				sum += collection.popFirst();
+			}
+			aisdi::doNotOptimize(sum);
+			state.stop();
+		});
+		runner.endSuite();
+	}
+};
+
+class ListBatchTests {
+private:
+	int repeat_count;
+
+public:
+	ListBatchTests(int n)
+		: repeat_count(n)
+	{}
+
+	void runTests(aisdi::BenchmarkRunner& runner)
+	{
+		const int batch_count = 10;
+
+		runner.beginSuite("LinkedList batch tests");
+		std::mt19937 random;
+		std::vector<aisdi::LinkedList<std::string>> batches(batch_count);
+		for (int i = 0; i < repeat_count; ++i) {
+			batches[i % batch_count].append("record" + std::to_string(random()));
+		}
+
+		runner.run("concatenating batches by copying", repeat_count, [&batches](aisdi::BenchmarkState& state)
+		{
+			aisdi::LinkedList<std::string> copied;
+			state.start();
+			for (const auto& batch : batches) {
+				for (const auto& record : batch) {
+					copied.append(record);
+				}
+			}
+			state.stop();
+		});
+		runner.run("concatenating batches with appendAll", batch_count, [&batches](aisdi::BenchmarkState& state)
+		{
+			std::vector<aisdi::LinkedList<std::string>> copies(batches);
+			aisdi::LinkedList<std::string> spliced;
+			state.start();
+			for (auto& batch : copies) {
+				spliced.appendAll(std::move(batch));
+			}
+			aisdi::doNotOptimize(spliced);
+			state.stop();
+		});
+
+		aisdi::LinkedList<std::string> records;
+		for (const auto& batch : batches) {
+			records.appendAll(aisdi::LinkedList<std::string>(batch));
+		}
+		runner.run("copying records", repeat_count, [&records](aisdi::BenchmarkState& state)
+		{
+			state.start();
+			aisdi::LinkedList<std::string> copy(records);
+			state.stop();
+		});
+		runner.run("sorting records", repeat_count, [&records](aisdi::BenchmarkState& state)
+		{
+			aisdi::LinkedList<std::string> copy(records);
+			state.start();
+			copy.sort();
+			state.stop();
+		});
+		runner.run("erasing records as a range", repeat_count, [&records](aisdi::BenchmarkState& state)
+		{
+			aisdi::LinkedList<std::string> copy(records);
+			state.start();
+			copy.erase(copy.begin(), copy.end());
+			state.stop();
+		});
+		runner.endSuite();
+	}
+};
+
+template <typename Collection>
+void addEntry(Collection& collection, int key)
+{
+	collection[key] = "test";
+}
+
+template <typename ValueType>
+void addEntry(aisdi::HashMap<std::string, ValueType>& collection, int key)
+{
+	collection[std::to_string(key)] = "test";
+}
+
+template <typename Type>
+void addEntry(aisdi::LinkedList<Type>& collection, int key)
+{
+	collection.append(key);
+}
+
+template <typename Type>
+void addEntry(aisdi::UnrolledLinkedList<Type>& collection, int key)
+{
+	collection.append(key);
+}
+
+// what an empty collection allocates up front (HashMap's bucket array) and what every entry adds
+// (list and tree nodes), as counted by the global operator new
+template <typename Collection>
+class FootprintTests {
+private:
+	int repeat_count;
+	std::vector<int> indexes;
+
+public:
+	FootprintTests(int n)
+		: repeat_count(n)
+	{
+		std::mt19937 random;
+		for (int i = 0; i < repeat_count; ++i) {
+			indexes.push_back(i);
+		}
+		std::shuffle(indexes.begin(), indexes.end(), random);
+	}
+
+	void runTests(aisdi::BenchmarkRunner& runner)
+	{
+		bool was_enabled = aisdi::MemoryTracker::isEnabled();
+		aisdi::MemoryTracker::setEnabled(true);
+		runner.beginSuite(std::string(typeid(Collection).name()) + " footprint tests");
+		runner.run("filling collection", repeat_count, [this](aisdi::BenchmarkState& state)
+		{
+			aisdi::MemorySnapshot before = aisdi::MemoryTracker::snapshot();
+			Collection collection;
+			aisdi::MemorySnapshot empty = aisdi::MemoryTracker::snapshot();
+			for (int index : this->indexes) {
+				addEntry(collection, index);
+			}
+			aisdi::MemorySnapshot full = aisdi::MemoryTracker::snapshot();
+
+			double entries = static_cast<double>(this->indexes.size());
+			double bytes_per_entry = (full.live_bytes - before.live_bytes) / entries;
+			state.setCounter("empty_bytes", empty.live_bytes - before.live_bytes);
+			state.setCounter("bytes_per_entry", bytes_per_entry);
+			state.setCounter("node_bytes_per_entry", (full.live_bytes - empty.live_bytes) / entries);
+			state.setCounter("overhead_per_entry", bytes_per_entry - sizeof(typename Collection::value_type));
+		});
+		runner.endSuite();
+		aisdi::MemoryTracker::setEnabled(was_enabled);
+	}
+};
+
+class CacheTests {
+private:
+	int repeat_count;
+	int universe;
+	std::vector<int> lookups;
+
+public:
+	CacheTests(int n)
+		: repeat_count(n)
+		, universe(std::max(n / 10, 100))
+	{
+		// with uniform keys the steady-state hit ratio is close to capacity / universe
+		std::mt19937 random;
+		std::uniform_int_distribution<int> key(0, universe - 1);
+		for (int i = 0; i < repeat_count; ++i) {
+			lookups.push_back(key(random));
+		}
+	}
+
+	void runTests(aisdi::BenchmarkRunner& runner)
+	{
+		const double ratios[] = { 0.5, 0.9, 0.99 };
+
+		runner.beginSuite("LruCache tests");
+		for (double ratio : ratios) {
+			std::string name = "get/put keys, capacity " + std::to_string(static_cast<int>(ratio * 100)) + "% of keys";
+			runner.run(name, repeat_count, [this, ratio](aisdi::BenchmarkState& state)
+			{
+				aisdi::LruCache<int, std::string> cache(static_cast<std::size_t>(this->universe * ratio));
+				for (int key : this->lookups) {
+					if (cache.get(key) == nullptr) {
+						cache.put(key, "test");
+					}
+				}
+				cache.resetCounters();
+
+				state.start();
+				for (int key : this->lookups) {
+					if (cache.get(key) == nullptr) {
+						cache.put(key, "test");
+					}
+				}
+				state.stop();
+				state.setCounter("hit_ratio", static_cast<double>(cache.getHits()) / (cache.getHits() + cache.getMisses()));
+			});
+		}
+
+		std::vector<int> int_keys;
+		std::vector<std::string> string_keys;
+		for (int i = 0; i < repeat_count; ++i) {
+			int_keys.push_back(i);
+			string_keys.push_back("user:" + std::to_string(i));
+		}
+		hitTests(runner, "int", int_keys);
+		hitTests(runner, "string", string_keys);
+		runner.endSuite();
+	}
+
+private:
+	// a full cache of 1%, 10% and 100% of the keys, searched only for keys it holds; the time per get
+	// should not grow with the capacity beyond what cache misses add
+	template <typename KeyType>
+	void hitTests(aisdi::BenchmarkRunner& runner, const std::string& key_name, const std::vector<KeyType>& keys)
+	{
+		for (std::size_t capacity = std::max<std::size_t>(keys.size() / 100, 1); capacity <= keys.size(); capacity *= 10) {
+			std::vector<std::size_t> lookups;
+			std::mt19937 random;
+			std::uniform_int_distribution<std::size_t> index(0, capacity - 1);
+			for (int i = 0; i < repeat_count; ++i) {
+				lookups.push_back(index(random));
+			}
+
+			std::string name = "get hits, " + key_name + " keys, capacity " + std::to_string(capacity);
+			runner.run(name, repeat_count, [&keys, &lookups, capacity](aisdi::BenchmarkState& state)
+			{
+				aisdi::LruCache<KeyType, std::string> cache(capacity);
+				for (std::size_t i = 0; i < capacity; ++i) {
+					cache.put(keys[i], "test");
+				}
+
+				std::size_t found = 0;
+				state.start();
+				for (std::size_t i : lookups) {
+					found += cache.get(keys[i]) != nullptr;
+				}
+				aisdi::doNotOptimize(found);
+				state.stop();
+			});
+		}
+	}
+};
+
+class SnapshotTests {
+private:
+	using Map = aisdi::PersistentTreeMap<int, std::string>;
+
+	int repeat_count;
+	std::vector<int> indexes;
+	// key and whether the write removes it; decided up front, so the timed loops only write
+	std::vector<std::pair<int, bool>> writes;
+
+	Map filled() const
+	{
+		Map map;
+		for (int index : indexes) {
+			map[index] = "test";
+		}
+		return map;
+	}
+
+	static void write(Map& map, const std::pair<int, bool>& operation)
+	{
+		if (operation.second) {
+			map.remove(operation.first);
+		}
+		else {
+			map[operation.first] = "test";
+		}
+	}
+
+public:
+	SnapshotTests(int n)
+		: repeat_count(n)
+	{
+		std::mt19937 random;
+		for (int i = 0; i < repeat_count; ++i) {
+			indexes.push_back(i);
+		}
+		std::shuffle(indexes.begin(), indexes.end(), random);
+		// every fourth write removes its key if it is there, the others insert or update
+		std::vector<bool> present(2 * repeat_count, false);
+		for (int index : indexes) {
+			present[index] = true;
+		}
+		std::uniform_int_distribution<int> key(0, 2 * repeat_count - 1);
+		for (int i = 0; i < repeat_count; ++i) {
+			int k = key(random);
+			bool removal = i % 4 == 3 && present[k];
+			present[k] = !removal;
+			writes.emplace_back(k, removal);
+		}
+	}
+
+	void runTests(aisdi::BenchmarkRunner& runner)
+	{
+		bool was_enabled = aisdi::MemoryTracker::isEnabled();
+		aisdi::MemoryTracker::setEnabled(true);
+		runner.beginSuite("PersistentTreeMap snapshot tests");
+		runner.run("taking snapshots", repeat_count, [this](aisdi::BenchmarkState& state)
+		{
+			Map map = this->filled();
+			std::size_t sizes = 0;
+			state.start();
+			for (int i = 0; i < this->repeat_count; ++i) {
+				Map view = map.snapshot();
+				sizes += view.getSize();
+			}
+			aisdi::doNotOptimize(sizes);
+			state.stop();
+		});
+		// what a point-in-time view costs without sharing
+		const int copies = 10;
+		runner.run("copying a TreeMap", copies, [this, copies](aisdi::BenchmarkState& state)
+		{
+			aisdi::TreeMap<int, std::string> tree;
+			for (int index : this->indexes) {
+				tree[index] = "test";
+			}
+			std::size_t sizes = 0;
+			state.start();
+			for (int i = 0; i < copies; ++i) {
+				aisdi::TreeMap<int, std::string> view(tree);
+				sizes += view.getSize();
+			}
+			aisdi::doNotOptimize(sizes);
+			state.stop();
+		});
+		writeTests(runner, "writing without snapshots", 0);
+		writeTests(runner, "writing with a snapshot every 100 writes", 100);
+		writeTests(runner, "writing with a snapshot after every write", 1);
+		runner.run("writing while a reader iterates snapshots", repeat_count, [this](aisdi::BenchmarkState& state)
+		{
+			Map map = this->filled();
+			Map published = map.snapshot();
+			std::mutex mutex;
+			std::atomic<bool> done(false);
+			std::size_t reads = 0;
+
+			state.start();
+			std::thread reader([&published, &mutex, &done, &reads]()
+			{
+				std::size_t found = 0;
+				while (!done.load()) {
+					Map view;
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						view = published;
+					}
+					for (auto it = view.begin(); it != view.end(); ++it) {
+						found += it->second.size();
+					}
+					++reads;
+				}
+				aisdi::doNotOptimize(found);
+			});
+			for (int i = 0; i < this->repeat_count; ++i) {
+				write(map, this->writes[i]);
+				if (i % 1000 == 999) {
+					Map view = map.snapshot();
+					std::lock_guard<std::mutex> lock(mutex);
+					published = std::move(view);
+				}
+			}
+			done = true;
+			reader.join();
+			state.stop();
+			state.setCounter("snapshots_read", reads);
+		});
+		runner.endSuite();
+		aisdi::MemoryTracker::setEnabled(was_enabled);
+	}
+
+private:
+	// a snapshot kept after every interval-th write (never for 0) makes the following writes copy
+	// their paths; nodes_per_write counts the allocations, which are all nodes here
+	void writeTests(aisdi::BenchmarkRunner& runner, const std::string& name, int interval)
+	{
+		runner.run(name, repeat_count, [this, interval](aisdi::BenchmarkState& state)
+		{
+			Map map = this->filled();
+			Map view;
+			aisdi::MemorySnapshot before = aisdi::MemoryTracker::snapshot();
+			state.start();
+			for (int i = 0; i < this->repeat_count; ++i) {
+				write(map, this->writes[i]);
+				if (interval != 0 && i % interval == interval - 1) {
+					view = map.snapshot();
+				}
+			}
+			state.stop();
+			aisdi::MemorySnapshot after = aisdi::MemoryTracker::snapshot();
+			if (aisdi::MemoryTracker::isSupported()) {
+				state.setCounter("nodes_per_write", static_cast<double>(after.allocations - before.allocations) / this->repeat_count);
+			}
+		});
+	}
+};
+
+// structure of the repository's maps as counters; other collections have nothing to report
+template <typename Collection>
+void reportStats(aisdi::BenchmarkState&, const Collection&)
+{}
+
+void reportOperations(aisdi::BenchmarkState& state, const aisdi::OperationCounts& operations)
+{
+	// only counted in builds with AISDI_MAP_COUNTERS
+	if (operations.lookups != 0) {
+		state.setCounter("comparisons_per_lookup", static_cast<double>(operations.comparisons) / operations.lookups);
+	}
+}
+
+template <typename KeyType, typename ValueType>
+void reportStats(aisdi::BenchmarkState& state, const aisdi::HashMap<KeyType, ValueType>& collection)
+{
+	aisdi::HashMapStats stats = collection.stats();
+	state.setCounter("max_chain", stats.max_chain);
+	state.setCounter("empty_buckets", stats.empty_bucket_ratio);
+	state.setCounter("probes_hit", stats.average_probes_hit);
+	state.setCounter("probes_miss", stats.average_probes_miss);
+	reportOperations(state, stats.operations);
+}
+
+template <typename KeyType, typename ValueType, typename Compare>
+void reportStats(aisdi::BenchmarkState& state, const aisdi::TreeMap<KeyType, ValueType, Compare>& collection)
+{
+	aisdi::TreeMapStats stats = collection.stats();
+	state.setCounter("height", stats.height);
+	state.setCounter("average_depth", stats.average_depth);
+	reportOperations(state, stats.operations);
+}
+
+template <typename Collection>
+class WorkloadTests {
+private:
+	using key_type = typename Collection::key_type;
+	using Stream = std::pair<aisdi::OperationMix, std::vector<aisdi::Operation>>;
+
+	std::string suite;
+	std::size_t records;
+	const std::vector<key_type>& keys;
+	const std::vector<Stream>& streams;
+	std::string value;
+
+	void load(Collection& collection) const
+	{
+		for (std::size_t i = 0; i < records; ++i) {
+			collection[keys[i]] = value;
+		}
+	}
+
+public:
+	// keys holds the records loaded up front followed by the keys the streams insert
+	WorkloadTests(const std::string& suite, std::size_t records, const std::vector<key_type>& keys,
+		const std::vector<Stream>& streams, std::size_t value_size)
+		: suite(suite)
+		, records(records)
+		, keys(keys)
+		, streams(streams)
+		, value(aisdi::WorkloadGenerator::value(value_size))
+	{}
+
+	void runTests(aisdi::BenchmarkRunner& runner)
+	{
+		runner.beginSuite(suite);
+		runner.run("loading records", records, [this](aisdi::BenchmarkState& state)
+		{
+			Collection collection;
+			state.start();
+			this->load(collection);
+			aisdi::clobberMemory();
+			state.stop();
+			state.setCounter("distinct", collection.getSize());
+			reportStats(state, collection);
+		});
+
+		for (const Stream& stream : streams) {
+			const std::vector<aisdi::Operation>& operations = stream.second;
+			std::string name = std::string("YCSB ") + stream.first.name;
+			runner.run(name, operations.size(), [this, &operations](aisdi::BenchmarkState& state)
+			{
+				Collection collection;
+				this->load(collection);
+
+				std::size_t found = 0;
+				state.start();
+				for (const aisdi::Operation& operation : operations) {
+					const key_type& key = this->keys[operation.key];
+					switch (operation.type) {
+					case aisdi::OperationType::Read:
+						found += collection.find(key) != collection.end();
+						break;
+					case aisdi::OperationType::Update:
+					case aisdi::OperationType::Insert:
+						collection[key] = this->value;
+						break;
+					case aisdi::OperationType::Scan: {
+						auto it = collection.find(key);
+						found += it != collection.end();
+						for (std::size_t i = 0; i < operation.length && it != collection.end(); ++i, ++it) {
+							aisdi::doNotOptimize(*it);
+						}
+						break;
+					}
+					case aisdi::OperationType::ReadModifyWrite: {
+						auto it = collection.find(key);
+						if (it != collection.end()) {
+							++found;
+							aisdi::doNotOptimize(it->second.size());
+							it->second = this->value;
+						}
+						break;
+					}
+					}
+				}
+				aisdi::doNotOptimize(found);
+				aisdi::clobberMemory();
+				state.stop();
+				state.setCounter("found", found);
+			});
+		}
+		runner.endSuite();
+	}
+};
+
+namespace
+{
+	// matches --name=value and stores the value
+	bool parseOption(const std::string& argument, const std::string& name, std::string& value)
+	{
+		std::string prefix = "--" + name + "=";
+		if (argument.compare(0, prefix.size(), prefix) != 0) {
+			return false;
+		}
+		value = argument.substr(prefix.size());
+		return true;
+	}
+
+	int usage(const char* program)
+	{
+		std::cerr << "usage: " << program << " [element count] [--format=text|json|csv] [--warmup=N] [--repetitions=N]\n"
+			<< "  [--counters=on|off] [--memory=on|off] [--suite=all|standard|workload]\n"
+			<< "  [--maps=hashmap,treemap,unordered_map,map] [--ycsb=ABCDEF] [--baseline=FILE] [--threshold=PERCENT]\n"
+			<< "  [--keys=sequential,reverse,uniform,zipf,clustered,adversarial|all] [--key-length=N] [--value-size=N]\n";
+		return 1;
+	}
+
+	const std::pair<const char*, aisdi::KeyDistribution> DISTRIBUTIONS[] = {
+		{ "sequential", aisdi::KeyDistribution::Sequential },
+		{ "reverse", aisdi::KeyDistribution::Reverse },
+		{ "uniform", aisdi::KeyDistribution::Uniform },
+		{ "zipf", aisdi::KeyDistribution::Zipf },
+		{ "clustered", aisdi::KeyDistribution::Clustered },
+		{ "adversarial", aisdi::KeyDistribution::Adversarial },
+	};
+
+	struct WorkloadOptions {
+		std::vector<std::pair<const char*, aisdi::KeyDistribution>> distributions;
+		std::vector<aisdi::OperationMix> mixes;
+		std::size_t key_length;
+		std::size_t value_size;
+		bool hashmap;
+		bool treemap;
+		bool unordered_map;
+		bool map;
+	};
+
+	std::vector<std::string> splitList(const std::string& value)
+	{
+		std::vector<std::string> items;
+		std::istringstream stream(value);
+		std::string item;
+		while (std::getline(stream, item, ',')) {
+			items.push_back(item);
+		}
+		return items;
+	}
+
+	bool parseDistributions(const std::string& value, WorkloadOptions& options)
+	{
+		options.distributions.clear();
+		for (const std::string& item : splitList(value)) {
+			bool known = false;
+			for (const auto& distribution : DISTRIBUTIONS) {
+				if (item == "all" || item == distribution.first) {
+					options.distributions.push_back(distribution);
+					known = true;
+				}
+			}
+			if (!known) {
+				return false;
+			}
+		}
+		return !options.distributions.empty();
+	}
+
+	bool parseMixes(const std::string& value, WorkloadOptions& options)
+	{
+		options.mixes.clear();
+		for (char workload : value) {
+			if (workload == ',') {
+				continue;
+			}
+			if (workload < 'A' || workload > 'F') {
+				return false;
+			}
+			options.mixes.push_back(aisdi::ycsbMix(workload));
+		}
+		return !options.mixes.empty();
+	}
+
+	bool parseMaps(const std::string& value, WorkloadOptions& options)
+	{
+		options.hashmap = false;
+		options.treemap = false;
+		options.unordered_map = false;
+		options.map = false;
+		for (const std::string& item : splitList(value)) {
+			if (item == "hashmap") {
+				options.hashmap = true;
+			}
+			else if (item == "treemap") {
+				options.treemap = true;
+			}
+			else if (item == "unordered_map") {
+				options.unordered_map = true;
+			}
+			else if (item == "map") {
+				options.map = true;
+			}
+			else {
+				return false;
+			}
+		}
+		return options.hashmap || options.treemap || options.unordered_map || options.map;
+	}
+
+	// baselines and the repository's maps under names that fit a template template parameter
+	template <typename KeyType, typename ValueType>
+	using HashMap = aisdi::HashMap<KeyType, ValueType>;
+
+	template <typename KeyType, typename ValueType>
+	using TreeMap = aisdi::TreeMap<KeyType, ValueType>;
+
+	template <typename KeyType, typename ValueType>
+	using UnorderedMap = aisdi::StdMapAdapter<std::unordered_map<KeyType, ValueType>>;
+
+	template <typename KeyType, typename ValueType>
+	using OrderedMap = aisdi::StdMapAdapter<std::map<KeyType, ValueType>>;
+
+	void runStandardSuites(aisdi::BenchmarkRunner& runner, int repeat_count)
+	{
+		Tests<aisdi::HashMap<int, std::string>> hashmap_tests(repeat_count);
+		Tests<aisdi::TreeMap<int, std::string>> treemap_tests(repeat_count);
+		Tests<UnorderedMap<int, std::string>> unordered_map_tests(repeat_count);
+		Tests<OrderedMap<int, std::string>> map_tests(repeat_count);
+		ConcurrentTests<aisdi::ConcurrentSkipListMap<int, std::string>> skiplist_tests(repeat_count);
+		ConcurrentTests<LockedTreeMap<int, std::string>> locked_treemap_tests(repeat_count);
+		QueueTests<LockedQueue<int>> locked_queue_tests(repeat_count);
+		QueueTests<aisdi::ConcurrentQueue<int>> concurrent_queue_tests(repeat_count);
+		SkewedAccessTests skewed_access_tests(repeat_count, 1.1);
+		CacheTests cache_tests(repeat_count);
+		SnapshotTests snapshot_tests(repeat_count);
+		ListTests<aisdi::LinkedList<int>> linked_list_tests(repeat_count);
+		ListTests<aisdi::UnrolledLinkedList<int>> unrolled_list_tests(repeat_count);
+		ListBatchTests list_batch_tests(repeat_count);
+		LsmTests lsm_tests(repeat_count);
+		LatencyTests<aisdi::HashMap<int, std::string>> hashmap_latency_tests(repeat_count);
+		LatencyTests<aisdi::TreeMap<int, std::string>> treemap_latency_tests(repeat_count);
+		LatencyTests<UnorderedMap<int, std::string>> unordered_map_latency_tests(repeat_count);
+		LatencyTests<OrderedMap<int, std::string>> map_latency_tests(repeat_count);
+		MissHeavyTests<aisdi::HashMap<int, std::string>> hashmap_miss_tests(repeat_count);
+		MissHeavyTests<aisdi::FilteredMap<aisdi::HashMap<int, std::string>>> filtered_hashmap_miss_tests(repeat_count);
+		MissHeavyTests<aisdi::TreeMap<int, std::string>> treemap_miss_tests(repeat_count);
+		MissHeavyTests<aisdi::FilteredMap<aisdi::TreeMap<int, std::string>>> filtered_treemap_miss_tests(repeat_count);
+		MissHeavyTests<UnorderedMap<int, std::string>> unordered_map_miss_tests(repeat_count);
+		MissHeavyTests<OrderedMap<int, std::string>> map_miss_tests(repeat_count);
+		ReadMostlyTests<aisdi::TreeMap<int, std::string>> treemap_read_tests(repeat_count);
+		ReadMostlyTests<aisdi::FlatMap<int, std::string>> flatmap_read_tests(repeat_count);
+		FrozenLookupTests frozen_tests(repeat_count);
+		FootprintTests<aisdi::HashMap<int, std::string>> hashmap_footprint_tests(repeat_count);
+		FootprintTests<aisdi::HashMap<std::string, std::string>> string_hashmap_footprint_tests(repeat_count);
+		FootprintTests<aisdi::TreeMap<int, std::string>> treemap_footprint_tests(repeat_count);
+		FootprintTests<UnorderedMap<int, std::string>> unordered_map_footprint_tests(repeat_count);
+		FootprintTests<OrderedMap<int, std::string>> map_footprint_tests(repeat_count);
+		FootprintTests<aisdi::LinkedList<int>> linked_list_footprint_tests(repeat_count);
+		FootprintTests<aisdi::UnrolledLinkedList<int>> unrolled_list_footprint_tests(repeat_count);
+	
+		std::mt19937 random;
+		std::vector<int> int_keys;
+		std::vector<std::string> string_keys;
+		for (int i = 0; i < repeat_count; ++i) {
+			int_keys.push_back(static_cast<int>(random()));
+			string_keys.push_back("user:" + std::to_string(random()));
+		}
+		KeyTypeTests<aisdi::TreeMap<int, int>> treemap_int_tests("int", int_keys);
+		KeyTypeTests<aisdi::HashMap<int, int>> hashmap_int_tests("int", int_keys);
+		KeyTypeTests<aisdi::RadixTreeMap<int, int>> radix_int_tests("int", int_keys);
+		KeyTypeTests<aisdi::TreeMap<std::string, int>> treemap_string_tests("string", string_keys);
+		KeyTypeTests<aisdi::HashMap<std::string, int>> hashmap_string_tests("string", string_keys);
+		KeyTypeTests<aisdi::RadixTreeMap<std::string, int>> radix_string_tests("string", string_keys);
+		hashmap_tests.runTests(runner);
+		treemap_tests.runTests(runner);
+		unordered_map_tests.runTests(runner);
+		map_tests.runTests(runner);
+		skiplist_tests.runTests(runner);
+		locked_treemap_tests.runTests(runner);
+		locked_queue_tests.runTests(runner);
+		concurrent_queue_tests.runTests(runner);
+		skewed_access_tests.runTests(runner);
+		cache_tests.runTests(runner);
+		snapshot_tests.runTests(runner);
+		linked_list_tests.runTests(runner);
+		unrolled_list_tests.runTests(runner);
+		list_batch_tests.runTests(runner);
+		lsm_tests.runTests(runner);
+		hashmap_latency_tests.runTests(runner);
+		treemap_latency_tests.runTests(runner);
+		unordered_map_latency_tests.runTests(runner);
+		map_latency_tests.runTests(runner);
+		hashmap_miss_tests.runTests(runner);
+		filtered_hashmap_miss_tests.runTests(runner);
+		treemap_miss_tests.runTests(runner);
+		filtered_treemap_miss_tests.runTests(runner);
+		unordered_map_miss_tests.runTests(runner);
+		map_miss_tests.runTests(runner);
+		treemap_read_tests.runTests(runner);
+		flatmap_read_tests.runTests(runner);
+		frozen_tests.runTests(runner);
+		if (aisdi::MemoryTracker::isSupported()) {
+			hashmap_footprint_tests.runTests(runner);
+			string_hashmap_footprint_tests.runTests(runner);
+			treemap_footprint_tests.runTests(runner);
+			unordered_map_footprint_tests.runTests(runner);
+			map_footprint_tests.runTests(runner);
+			linked_list_footprint_tests.runTests(runner);
+			unrolled_list_footprint_tests.runTests(runner);
+		}
+		treemap_int_tests.runTests(runner);
+		hashmap_int_tests.runTests(runner);
+		radix_int_tests.runTests(runner);
+		treemap_string_tests.runTests(runner);
+		hashmap_string_tests.runTests(runner);
+		radix_string_tests.runTests(runner);
+	}
+
+	using Stream = std::pair<aisdi::OperationMix, std::vector<aisdi::Operation>>;
+
+	// one map family with uint64_t and with string keys
+	template <template <typename, typename> class Map>
+	void runMapWorkloads(aisdi::BenchmarkRunner& runner, const std::string& map_name, const std::string& description,
+		std::size_t records, const std::vector<std::uint64_t>& integer_keys, const std::vector<std::string>& string_keys,
+		const std::vector<Stream>& streams, const WorkloadOptions& options)
+	{
+		WorkloadTests<Map<std::uint64_t, std::string>>(map_name + " uint64" + description, records, integer_keys,
+			streams, options.value_size).runTests(runner);
+		WorkloadTests<Map<std::string, std::string>>(map_name + " " + std::to_string(options.key_length) + " B string"
+			+ description, records, string_keys, streams, options.value_size).runTests(runner);
+	}
+
+	// loads repeat_count records and replays repeat_count operations of every selected mix
+	void runWorkloads(aisdi::BenchmarkRunner& runner, int repeat_count, const WorkloadOptions& options)
+	{
+
+		std::size_t records = repeat_count;
+		aisdi::WorkloadGenerator generator;
+		std::vector<Stream> streams;
+		std::size_t inserts = 0;
+		for (const aisdi::OperationMix& mix : options.mixes) {
+			streams.emplace_back(mix, generator.operations(mix, records, records));
+			inserts = std::max(inserts, aisdi::WorkloadGenerator::countInserts(streams.back().second));
+		}
+
+		for (const auto& distribution : options.distributions) {
+			std::vector<std::uint64_t> integer_keys = generator.integerKeys(distribution.second, records + inserts);
+			std::vector<std::string> string_keys = generator.stringKeys(distribution.second, records + inserts,
+				options.key_length);
+			std::string description = std::string(" workload, ") + distribution.first + " keys, "
+				+ std::to_string(options.value_size) + " B values";
+			if (options.hashmap) {
+				runMapWorkloads<HashMap>(runner, "HashMap", description, records, integer_keys, string_keys, streams,
+					options);
+			}
+			if (options.treemap) {
+				runMapWorkloads<TreeMap>(runner, "TreeMap", description, records, integer_keys, string_keys, streams,
+					options);
+			}
+			if (options.unordered_map) {
+				runMapWorkloads<UnorderedMap>(runner, "std::unordered_map", description, records, integer_keys,
+					string_keys, streams, options);
+			}
+			if (options.map) {
+				runMapWorkloads<OrderedMap>(runner, "std::map", description, records, integer_keys, string_keys,
+					streams, options);
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int repeat_count = 100000;
+	aisdi::BenchmarkFormat format = aisdi::BenchmarkFormat::Text;
+	std::size_t warmup = 1;
+	std::size_t repetitions = 5;
+	std::string suite = "all";
+	bool hardware_counters = true;
+	bool memory_tracking = false;
+	std::string baseline_path;
+	double threshold = 10;
+	WorkloadOptions workload_options;
+	parseDistributions("uniform", workload_options);
+	parseMixes("ABCDEF", workload_options);
+	parseMaps("hashmap,treemap,unordered_map,map", workload_options);
+	workload_options.key_length = 16;
+	workload_options.value_size = 8;
+	for (int i = 1; i < argc; ++i) {
+		std::string argument = argv[i];
+		std::string value;
+		if (parseOption(argument, "format", value)) {
+			if (value == "text") {
+				format = aisdi::BenchmarkFormat::Text;
+			}
+			else if (value == "json") {
+				format = aisdi::BenchmarkFormat::Json;
+			}
+			else if (value == "csv") {
+				format = aisdi::BenchmarkFormat::Csv;
+			}
+			else {
+				return usage(argv[0]);
+			}
+		}
+		else if (parseOption(argument, "warmup", value)) {
+			warmup = std::strtoul(value.c_str(), nullptr, 10);
+		}
+		else if (parseOption(argument, "repetitions", value)) {
+			repetitions = std::strtoul(value.c_str(), nullptr, 10);
+			if (repetitions == 0) {
+				return usage(argv[0]);
+			}
+		}
+		else if (parseOption(argument, "counters", value)) {
+			if (value != "on" && value != "off") {
+				return usage(argv[0]);
+			}
+			hardware_counters = value == "on";
+		}
+		else if (parseOption(argument, "memory", value)) {
+			if (value != "on" && value != "off") {
+				return usage(argv[0]);
+			}
+			memory_tracking = value == "on";
+		}
+		else if (parseOption(argument, "baseline", value)) {
+			baseline_path = value;
+		}
+		else if (parseOption(argument, "threshold", value)) {
+			char* end = nullptr;
+			threshold = std::strtod(value.c_str(), &end);
+			if (value.empty() || *end != '\0' || !std::isfinite(threshold) || threshold < 0) {
+				return usage(argv[0]);
+			}
+		}
+		else if (parseOption(argument, "suite", value)) {
+			if (value != "all" && value != "standard" && value != "workload") {
+				return usage(argv[0]);
+			}
+			suite = value;
+		}
+		else if (parseOption(argument, "keys", value)) {
+			if (!parseDistributions(value, workload_options)) {
+				return usage(argv[0]);
+			}
+		}
+		else if (parseOption(argument, "ycsb", value)) {
+			if (!parseMixes(value, workload_options)) {
+				return usage(argv[0]);
+			}
+		}
+		else if (parseOption(argument, "maps", value)) {
+			if (!parseMaps(value, workload_options)) {
+				return usage(argv[0]);
+			}
+		}
+		else if (parseOption(argument, "key-length", value)) {
+			workload_options.key_length = std::strtoul(value.c_str(), nullptr, 10);
+			if (workload_options.key_length == 0) {
+				return usage(argv[0]);
+			}
+		}
+		else if (parseOption(argument, "value-size", value)) {
+			workload_options.value_size = std::strtoul(value.c_str(), nullptr, 10);
+		}
+		else if (!argument.empty() && argument[0] != '-') {
+			repeat_count = std::atoi(argument.c_str());
+		}
+		else {
+			return usage(argv[0]);
+		}
+	}
+	if (repeat_count < 2) {
+		return usage(argv[0]);
+	}
+
+	// read up front, so that a bad file does not waste a whole run
+	aisdi::BenchmarkBaseline baseline;
+	if (!baseline_path.empty()) {
+		std::ifstream file(baseline_path);
+		if (!file) {
+			std::cerr << "cannot open baseline " << baseline_path << "\n";
+			return 1;
+		}
+		try {
+			baseline = aisdi::BenchmarkBaseline::load(file);
+		}
+		catch (const std::runtime_error& error) {
+			std::cerr << baseline_path << ": " << error.what() << "\n";
+			return 1;
+		}
+	}
+
+	aisdi::BenchmarkRunner runner(std::cout, format, warmup, repetitions);
+	if (hardware_counters && !runner.setHardwareCounters(true)) {
+		std::cerr << "hardware counters are not available, reporting times only\n";
+	}
+	if (memory_tracking && !runner.setMemoryTracking(true)) {
+		std::cerr << "allocations cannot be counted on this system\n";
+	}
+	if (suite != "workload") {
+		runStandardSuites(runner, repeat_count);
+	}
+	if (suite != "standard") {
+		runWorkloads(runner, repeat_count, workload_options);
+	}
+	runner.finish();
+
+	if (baseline_path.empty()) {
+		return 0;
+	}
+	std::size_t matched = 0;
+	std::vector<aisdi::BenchmarkRegression> regressions = baseline.compare(runner.getResults(), threshold / 100, &matched);
+	for (const aisdi::BenchmarkRegression& regression : regressions) {
+		std::cerr << "regression: " << regression.suite << " / " << regression.name << ": " << regression.baseline_ns
+			<< " ns -> " << regression.current_ns << " ns (+"
+			<< (regression.current_ns / regression.baseline_ns - 1) * 100 << "%)\n";
+	}
+	std::cerr << regressions.size() << " of " << matched << " scenarios regressed by more than " << threshold
+		<< "% against " << baseline_path << "\n";
+	// suite names come from typeid, so a baseline written by another compiler may match nothing
+	if (matched == 0 && baseline.getSize() != 0) {
+		std::cerr << "no scenario of " << baseline_path << " (" << baseline.getSize()
+			<< " in total) matched this run, nothing was compared\n";
+		return 1;
+	}
+	return regressions.empty() ? 0 : 2;
 }